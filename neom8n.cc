@@ -1,4 +1,28 @@
 #include <cstring>
+#if defined(__linux__)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+/* the io_uring backend relies on IOSQE_CQE_SKIP_SUCCESS, so it needs the headers of Linux 5.17 or later */
+#if defined(IOSQE_CQE_SKIP_SUCCESS) && defined(__NR_io_uring_setup)
+#define NEOM8N_IO_URING
+#endif
+#endif
+#include <netdb.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include "neom8n.h"
 
 using std::cout;
@@ -9,208 +33,2581 @@ using std::string;
 using std::exception;
 
 namespace neom8n {
-    NeoM8N::NeoM8N(const std::string &device) {
-        reading = false;
+    namespace {
+        /* how long writing to the port may make no progress before it is given up, e.g. when the line is held off */
+        constexpr int WRITE_STALL_TIMEOUT_MS = 1000;
+
+        speed_t baudRateToSpeed(unsigned int baudRate) {
+            switch (baudRate) {
+                case 4800:
+                    return B4800;
+                case 9600:
+                    return B9600;
+                case 19200:
+                    return B19200;
+                case 38400:
+                    return B38400;
+                case 57600:
+                    return B57600;
+                case 115200:
+                    return B115200;
+                case 230400:
+                    return B230400;
+#ifdef B460800
+                case 460800:
+                    return B460800;
+#endif
+#ifdef B921600
+                case 921600:
+                    return B921600;
+#endif
+                default:
+                    throw UnsupportedBaudRateError();
+            }
+        }
+
+        void putLE16(std::vector<uint8_t> &v, uint16_t x) {
+            v.push_back(x & 0xff);
+            v.push_back(x >> 8);
+        }
+
+        void putLE32(std::vector<uint8_t> &v, uint32_t x) {
+            putLE16(v, x & 0xffff);
+            putLE16(v, x >> 16);
+        }
+
+        /**
+         * drainOutput waits until the output queued for the port has been transmitted, like tcdrain, but gives up and
+         * discards it when the transmission stalls.
+         */
+        void drainOutput(int fd) {
+#ifdef TIOCOUTQ
+            int queued = 0;
+            int last = -1;
+            auto progress = std::chrono::steady_clock::now();
+            while (ioctl(fd, TIOCOUTQ, &queued) == 0 && queued > 0) {
+                if (queued != last) {
+                    last = queued;
+                    progress = std::chrono::steady_clock::now();
+                } else if (std::chrono::steady_clock::now() - progress >
+                           std::chrono::milliseconds(WRITE_STALL_TIMEOUT_MS)) {
+                    clog << "ERROR: output stalled, discarding " << queued << " bytes" << endl;
+                    tcflush(fd, TCOFLUSH);
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+#endif
+            /* only the transmitter's FIFO is left */
+            tcdrain(fd);
+        }
+
+        /**
+         * openSerialPort opens the device and configures it for reading NMEA: raw, non-blocking, 8N1 at the given
+         * speed.
+         * @return the descriptor, or -1 (with errno set) if the device could not be opened
+         */
+        int openSerialPort(const std::string &device, speed_t speed, struct termios &oldSettings,
+                           struct termios &newSettings) {
+            /*
+              Open modem device for reading and writing and not as controlling tty
+              because we don't want to get killed if linenoise sends CTRL-C.
+            */
+            int fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+            if (fd < 0) {
+                return -1;
+            }
+            tcgetattr(fd, &oldSettings); /* save current serial port settings */
+            bzero(&newSettings, sizeof(newSettings)); /* clear struct for new port settings */
+            fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            /*
+               BAUDRATE: Set bps rate (below, with cfsetispeed and cfsetospeed).
+               No CRTSCTS: the receiver's UART has no RTS/CTS lines, so with hardware
+                         flow control a TX/RX/GND connection would never send
+               CS8     : 8n1 (8bit,no parity,1 stopbit)
+               CLOCAL  : local connection, no modem contol
+               CREAD   : enable receiving characters
+             */
+            newSettings.c_cflag = CS8 | CLOCAL | CREAD;
+            cfsetispeed(&newSettings, speed);
+            cfsetospeed(&newSettings, speed);
+            /*
+              IGNPAR  : ignore bytes with parity errors
+              otherwise make device raw (no other input processing), so that
+              line endings reach the sentence framer untouched
+            */
+            newSettings.c_iflag = IGNPAR;
+            /*
+             Raw output.
+            */
+            newSettings.c_oflag = 0;
+            /*
+              non-canonical input: read() returns whatever has been received instead
+              of one line at a time, the sentences are framed by the reader
+              disable all echo functionality, and don't send signals to calling program
+            */
+            newSettings.c_lflag = 0;
+            /*
+              initialize all control characters
+              default values can be found in /usr/include/termios.h, and are given
+              in the comments, but we don't need them here
+            */
+            newSettings.c_cc[VINTR] = 0;     /* Ctrl-c */
+            newSettings.c_cc[VQUIT] = 0;     /* Ctrl-\ */
+            newSettings.c_cc[VERASE] = 0;     /* del */
+            newSettings.c_cc[VKILL] = 0;     /* @ */
+            newSettings.c_cc[VEOF] = 4;     /* Ctrl-d */
+            newSettings.c_cc[VTIME] = 0;     /* inter-character timer unused */
+            newSettings.c_cc[VMIN] = 1;     /* blocking read until 1 character arrives */
+            newSettings.c_cc[/*VSWTC*/7] = 0;     /* '\0' */
+            newSettings.c_cc[VSTART] = 0;     /* Ctrl-q */
+            newSettings.c_cc[VSTOP] = 0;     /* Ctrl-s */
+            newSettings.c_cc[VSUSP] = 0;     /* Ctrl-z */
+            newSettings.c_cc[VEOL] = 0;     /* '\0' */
+            newSettings.c_cc[VREPRINT] = 0;     /* Ctrl-r */
+            newSettings.c_cc[VDISCARD] = 0;     /* Ctrl-u */
+            newSettings.c_cc[VWERASE] = 0;     /* Ctrl-w */
+            newSettings.c_cc[VLNEXT] = 0;     /* Ctrl-v */
+            newSettings.c_cc[VEOL2] = 0;     /* '\0' */
+            /*
+              now clean the modem line and activate the settings for the port
+            */
+            tcflush(fd, TCIFLUSH);
+            tcsetattr(fd, TCSANOW, &newSettings);
+            return fd;
+        }
+
+        /**
+         * openWakeup creates a descriptor pair that is readable after signalWakeup, to interrupt poll() or
+         * epoll_wait(); on failure it returns false with errno set
+         */
+        bool openWakeup(int &readFd, int &writeFd) {
+#if defined(__linux__)
+            readFd = writeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (readFd < 0) {
+                return false;
+            }
+#else
+            int wakeFds[2];
+            if (pipe(wakeFds) < 0) {
+                return false;
+            }
+            fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+            fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+            readFd = wakeFds[0];
+            writeFd = wakeFds[1];
+#endif
+            return true;
+        }
+
+        void signalWakeup(int writeFd) {
+            /* an eventfd requires an 8-byte write; for a pipe any write will do */
+            uint64_t one = 1;
+            if (write(writeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+                clog << "ERROR: " << strerror(errno) << endl;
+            }
+        }
+
+        void drainWakeup(int readFd) {
+            uint64_t wakeups;
+            while (read(readFd, &wakeups, sizeof(wakeups)) > 0) {}
+        }
+
+        void closeWakeup(int readFd, int writeFd) {
+            close(readFd);
+            if (writeFd != readFd) {
+                close(writeFd);
+            }
+        }
+    }
+
+    ByteSource::ByteSource(int fd) : fd(fd) {}
+
+    ByteSource::~ByteSource() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int ByteSource::Fd() const {
+        return fd;
+    }
+
+    void ByteSource::SetSpeed(unsigned int) {}
+
+    SerialSource::SerialSource(const std::string &device, unsigned int baudRate) : ByteSource(-1) {
+        fd = openSerialPort(device, baudRateToSpeed(baudRate), oldSettings, newSettings);
+        if (fd < 0) {
+            throw DeviceError(device + ": " + strerror(errno));
+        }
+    }
+
+    SerialSource::~SerialSource() {
+        /* restore the old port settings */
+        tcsetattr(fd, TCSANOW, &oldSettings);
+    }
+
+    void SerialSource::SetSpeed(unsigned int baudRate) {
+        auto speed = baudRateToSpeed(baudRate);
+        /* pending output, e.g. the command that changes the receiver's rate, has to leave at the old rate */
+        drainOutput(fd);
+        cfsetispeed(&newSettings, speed);
+        cfsetospeed(&newSettings, speed);
+        tcsetattr(fd, TCSADRAIN, &newSettings);
         /*
-          Open modem device for reading and writing and not as controlling tty
-          because we don't want to get killed if linenoise sends CTRL-C.
+          input is not flushed: the receiver's acknowledgement follows at the new rate right away, and bytes garbled
+          by the switch fail the checksum
         */
-        fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+    }
+
+    FileSource::FileSource(const std::string &path) : ByteSource(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+        if (fd < 0) {
+            throw DeviceError(path + ": " + strerror(errno));
+        }
+    }
+
+    DescriptorSource::DescriptorSource(int fd, bool owned) : ByteSource(fd), owned(owned) {}
+
+    DescriptorSource::~DescriptorSource() {
+        if (!owned) {
+            fd = -1;
+        }
+    }
+
+    PseudoTerminalSource::PseudoTerminalSource() : ByteSource(posix_openpt(O_RDWR | O_NOCTTY)), slaveFd(-1) {
+        if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+            throw DeviceError(std::string("pseudo terminal: ") + strerror(errno));
+        }
+        slaveName = ptsname(fd);
+        slaveFd = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+        if (slaveFd < 0) {
+            throw DeviceError(slaveName + ": " + strerror(errno));
+        }
+        struct termios raw{};
+        tcgetattr(slaveFd, &raw);
+        cfmakeraw(&raw);
+        tcsetattr(slaveFd, TCSANOW, &raw);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    PseudoTerminalSource::~PseudoTerminalSource() {
+        if (slaveFd >= 0) {
+            close(slaveFd);
+        }
+    }
+
+    const std::string &PseudoTerminalSource::SlaveName() const {
+        return slaveName;
+    }
+
+    SocketSource::SocketSource(const std::string &host, uint16_t port) : ByteSource(-1) {
+        struct addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo *addresses;
+        auto err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+        if (err != 0) {
+            throw DeviceError(host + ": " + gai_strerror(err));
+        }
+        /* try the addresses in order until one accepts the connection */
+        for (auto a = addresses; a != nullptr && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+                err = errno;
+                close(fd);
+                fd = -1;
+                errno = err;
+            }
+        }
+        err = errno;
+        freeaddrinfo(addresses);
         if (fd < 0) {
-            perror(device.c_str());
-            exit(-1);
+            throw DeviceError(host + ":" + std::to_string(port) + ": " + strerror(err));
+        }
+    }
+
+    SocketSource::SocketSource(const std::string &path) : ByteSource(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) {
+        struct sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw DeviceError(path + ": path too long");
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+            throw DeviceError(path + ": " + strerror(errno));
+        }
+    }
+
+    NeoM8N::NeoM8N(const std::string &device, unsigned int baudRate) :
+            NeoM8N(std::make_unique<SerialSource>(device, baudRate), baudRate) {}
+
+    NeoM8N::NeoM8N(std::unique_ptr<ByteSource> source, unsigned int baudRate) :
+            source(std::move(source)), baudRate(baudRate) {
+        if (!openWakeup(wakeReadFd, wakeWriteFd)) {
+            throw DeviceError(std::string("wake-up descriptor: ") + strerror(errno));
+        }
+    }
+
+    void NeoM8N::wake() {
+        signalWakeup(wakeWriteFd);
+    }
+
+    bool NeoM8N::writeAll(const uint8_t *data, size_t length) {
+        /* the port is non-blocking, so wait for it to drain when the output buffer is full */
+        struct pollfd pfd = {source->Fd(), POLLOUT, 0};
+        while (length > 0) {
+            auto res = write(source->Fd(), data, length);
+            if (res < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    if (poll(&pfd, 1, WRITE_STALL_TIMEOUT_MS) == 0) {
+                        clog << "ERROR: writing to the device timed out" << endl;
+                        return false;
+                    }
+                    continue;
+                }
+                clog << "ERROR: " << strerror(errno) << endl;
+                return false;
+            }
+            data += res;
+            length -= res;
+        }
+        return true;
+    }
+
+    AckStatus NeoM8N::SetBaudRate(unsigned int rate, std::chrono::milliseconds timeout) {
+        /* reject rates the host cannot follow before the receiver is switched */
+        baudRateToSpeed(rate);
+        unsigned int previous = baudRate;
+        std::future<AckStatus> result;
+        {
+            /* no other command may be written between the CFG-PRT and the switch, as it would leave at the wrong rate */
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            if (!fitsLink(outputTypes, NavigationRate(), rate)) {
+                return ACK_LINK_OVERLOADED;
+            }
+            if (!sendCommand(EncodeCFGPRT(rate), timeout, result)) {
+                /* the receiver has not switched */
+                return ACK_WRITE_FAILED;
+            }
+            /* the receiver answers at the new rate */
+            source->SetSpeed(rate);
+        }
+        auto status = awaitCommand(result, std::chrono::steady_clock::now() + timeout);
+        if (status == ACK_TIMEOUT) {
+            /* the receiver switches before it answers, so the answer may just have been garbled */
+            if (answersAt(rate, timeout)) {
+                status = ACK_OK;
+            } else if (!answersAt(previous, timeout)) {
+                clog << "ERROR: the receiver answers neither at " << rate << " nor at " << previous << " baud" << endl;
+            }
+        } else if (status != ACK_OK) {
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            source->SetSpeed(previous);
+        }
+        if (status == ACK_OK) {
+            baudRate = rate;
+        }
+        return status;
+    }
+
+    bool NeoM8N::answersAt(unsigned int rate, std::chrono::milliseconds timeout) {
+        std::future<AckStatus> result;
+        {
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            source->SetSpeed(rate);
+            /* UBX-CFG-PRT with only the port ID polls the port's configuration */
+            if (!sendCommand(EncodeUBX(UBX_CLASS_CFG, UBX_ID_CFG_PRT, {UBX_PORT_UART1}), timeout, result)) {
+                return false;
+            }
+        }
+        /* even a UBX-ACK-NAK can only have been read at the right rate */
+        auto status = awaitCommand(result, std::chrono::steady_clock::now() + timeout);
+        return status == ACK_OK || status == ACK_REJECTED;
+    }
+
+    unsigned int NeoM8N::BaudRate() const {
+        return baudRate;
+    }
+
+    std::array<AckStatus, SENTENCE_TYPE_COUNT> NeoM8N::SetSentenceOutput(const std::vector<SentenceType> &types,
+                                                                        std::chrono::milliseconds timeout) {
+        uint32_t requested = 0;
+        for (auto type : types) {
+            requested |= 1u << type;
+        }
+        /* send all commands before waiting for the first answer */
+        std::array<std::future<AckStatus>, SENTENCE_TYPE_COUNT> results;
+        {
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            if (!fitsLink(requested, NavigationRate(), baudRate)) {
+                std::array<AckStatus, SENTENCE_TYPE_COUNT> statuses;
+                statuses.fill(ACK_LINK_OVERLOADED);
+                return statuses;
+            }
+            for (size_t t = 0; t < SENTENCE_TYPE_COUNT; t++) {
+                uint8_t rate = requested & (1u << t) ? 1 : 0;
+                sendCommand(EncodeCFGMSG(UBX_CLASS_NMEA, NMEAMessageID(static_cast<SentenceType>(t)), rate), timeout,
+                            results[t]);
+            }
+        }
+        /* after every command's own deadline */
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::array<AckStatus, SENTENCE_TYPE_COUNT> statuses;
+        uint32_t enabled = outputTypes;
+        for (size_t t = 0; t < SENTENCE_TYPE_COUNT; t++) {
+            statuses[t] = awaitCommand(results[t], deadline);
+            /* only what the receiver acknowledged has changed */
+            if (statuses[t] == ACK_OK) {
+                enabled = (enabled & ~(1u << t)) | (requested & (1u << t));
+            }
+        }
+        outputTypes = enabled;
+        return statuses;
+    }
+
+    std::array<AckStatus, SENTENCE_TYPE_COUNT> NeoM8N::PruneSentenceOutput(std::chrono::milliseconds timeout) {
+        return SetSentenceOutput(SubscribedSentenceTypes(), timeout);
+    }
+
+    std::vector<SentenceType> NeoM8N::SubscribedSentenceTypes() const {
+        auto r = std::atomic_load(&registry);
+        std::vector<SentenceType> types;
+        for (size_t t = 0; t < SENTENCE_TYPE_COUNT; t++) {
+            if (!r->Subscriptions[t].empty()) {
+                types.push_back(static_cast<SentenceType>(t));
+            }
+        }
+        return types;
+    }
+
+    AckStatus NeoM8N::SetNavigationRate(uint16_t period, uint16_t rate, std::chrono::milliseconds timeout) {
+        if (period == 0 || rate == 0) {
+            clog << "ERROR: the measurement period and navigation rate must not be 0" << endl;
+            return ACK_INVALID_ARGUMENT;
+        }
+        std::future<AckStatus> result;
+        {
+            std::lock_guard<std::mutex> commandLock(commandMutex);
+            if (!fitsLink(outputTypes, 1000.0 / (period * rate), baudRate)) {
+                return ACK_LINK_OVERLOADED;
+            }
+            sendCommand(EncodeCFGRATE(period, rate), timeout, result);
+        }
+        auto status = awaitCommand(result, std::chrono::steady_clock::now() + timeout);
+        if (status == ACK_OK) {
+            measurementPeriod = period;
+            navigationRate = rate;
+        }
+        return status;
+    }
+
+    double NeoM8N::NavigationRate() const {
+        return 1000.0 / (measurementPeriod * navigationRate);
+    }
+
+    double NeoM8N::LinkUtilisation() const {
+        return linkUtilisation(outputTypes, NavigationRate(), baudRate);
+    }
+
+    double NeoM8N::linkUtilisation(uint32_t types, double solutionsPerSecond, unsigned int baud) {
+        size_t bytes = 0;
+        for (size_t t = 0; t < SENTENCE_TYPE_COUNT; t++) {
+            if (types & (1u << t)) {
+                bytes += EstimatedSentenceBytes(static_cast<SentenceType>(t));
+            }
+        }
+        /* 8N1: a start bit, 8 data bits and a stop bit per byte */
+        return bytes * solutionsPerSecond / (baud / 10.0);
+    }
+
+    bool NeoM8N::fitsLink(uint32_t types, double solutionsPerSecond, unsigned int baud) {
+        auto utilisation = linkUtilisation(types, solutionsPerSecond, baud);
+        if (utilisation > 1) {
+            clog << "ERROR: the output at " << solutionsPerSecond << " Hz would need about "
+                 << static_cast<int>(utilisation * 100) << "% of " << baud << " baud" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void NeoM8N::SendCommand(const std::vector<uint8_t> &command, CommandCallback done,
+                             std::chrono::milliseconds timeout) {
+        std::lock_guard<std::mutex> commandLock(commandMutex);
+        sendCommand(command, std::move(done), timeout);
+    }
+
+    std::future<AckStatus> NeoM8N::SendCommand(const std::vector<uint8_t> &command, std::chrono::milliseconds timeout) {
+        std::lock_guard<std::mutex> commandLock(commandMutex);
+        std::future<AckStatus> result;
+        sendCommand(command, timeout, result);
+        return result;
+    }
+
+    bool NeoM8N::sendCommand(const std::vector<uint8_t> &command, std::chrono::milliseconds timeout,
+                             std::future<AckStatus> &result) {
+        auto promise = std::make_shared<std::promise<AckStatus>>();
+        result = promise->get_future();
+        return sendCommand(command, [promise](AckStatus status) { promise->set_value(status); }, timeout);
+    }
+
+    bool NeoM8N::sendCommand(const std::vector<uint8_t> &command, CommandCallback done,
+                             std::chrono::milliseconds timeout) {
+        if (command.size() < UBX_FRAME_OVERHEAD) {
+            done(ACK_WRITE_FAILED);
+            return false;
+        }
+        uint64_t sequence;
+        {
+            /* track the command before writing it, as Read may see the answer as soon as it has been written */
+            std::lock_guard<std::mutex> lock(ackMutex);
+            sequence = commandSequence++;
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            pendingCommands.push_back({sequence, command[2], command[3], deadline, std::move(done)});
+            if (deadline.time_since_epoch().count() < nextDeadline) {
+                nextDeadline = deadline.time_since_epoch().count();
+            }
+        }
+        if (writeAll(command.data(), command.size())) {
+            /* let a blocked Read pick up the new deadline */
+            wake();
+            return true;
+        }
+        CommandCallback failed;
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            auto it = std::find_if(pendingCommands.begin(), pendingCommands.end(), [&](const pendingCommand &c) {
+                return c.Sequence == sequence;
+            });
+            if (it != pendingCommands.end()) {
+                failed = std::move(it->Done);
+                pendingCommands.erase(it);
+            }
+        }
+        if (failed) {
+            failed(ACK_WRITE_FAILED);
+        }
+        return false;
+    }
+
+    AckStatus NeoM8N::awaitCommand(std::future<AckStatus> &result, std::chrono::steady_clock::time_point deadline) {
+        /* without a running Read nobody else expires the command */
+        if (result.wait_until(deadline) == std::future_status::timeout) {
+            expireCommands(std::chrono::steady_clock::now());
+        }
+        return result.get();
+    }
+
+    void NeoM8N::acknowledge(const UBXFrame &frame) {
+        if (frame.PayloadLength != 2) {
+            return;
+        }
+        CommandCallback done;
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            auto it = std::find_if(pendingCommands.begin(), pendingCommands.end(), [&](const pendingCommand &c) {
+                return c.Class == frame.Payload[0] && c.ID == frame.Payload[1];
+            });
+            if (it == pendingCommands.end()) {
+                return;
+            }
+            done = std::move(it->Done);
+            pendingCommands.erase(it);
+        }
+        /* outside the lock, so that the callback may send further commands */
+        done(frame.ID == UBX_ID_ACK_ACK ? ACK_OK : ACK_REJECTED);
+    }
+
+    void NeoM8N::expireCommands(std::chrono::steady_clock::time_point now) {
+        std::vector<CommandCallback> expired;
+        {
+            std::lock_guard<std::mutex> lock(ackMutex);
+            auto next = std::chrono::steady_clock::time_point::max();
+            for (auto it = pendingCommands.begin(); it != pendingCommands.end();) {
+                if (it->Deadline <= now) {
+                    expired.push_back(std::move(it->Done));
+                    it = pendingCommands.erase(it);
+                } else {
+                    next = std::min(next, it->Deadline);
+                    ++it;
+                }
+            }
+            nextDeadline = next.time_since_epoch().count();
+        }
+        for (auto const &done : expired) {
+            done(ACK_TIMEOUT);
+        }
+    }
+
+    int NeoM8N::commandTimeout() {
+        auto deadline = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(nextDeadline));
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            return -1;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (deadline <= now) {
+            expireCommands(now);
+            return commandTimeout();
+        }
+        /* round up, so that poll() does not return just before the deadline */
+        return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count());
+    }
+
+    void UBXChecksum(const uint8_t *data, size_t length, uint8_t &ckA, uint8_t &ckB) {
+        ckA = 0;
+        ckB = 0;
+        for (size_t i = 0; i < length; i++) {
+            ckA += data[i];
+            ckB += ckA;
+        }
+    }
+
+    std::vector<uint8_t> EncodeUBX(uint8_t messageClass, uint8_t messageID, const std::vector<uint8_t> &payload) {
+        std::vector<uint8_t> frame = {UBX_SYNC_1, UBX_SYNC_2, messageClass, messageID};
+        frame.reserve(payload.size() + 8);
+        putLE16(frame, static_cast<uint16_t>(payload.size()));
+        frame.insert(frame.end(), payload.begin(), payload.end());
+        uint8_t ckA, ckB;
+        UBXChecksum(frame.data() + 2, frame.size() - 2, ckA, ckB);
+        frame.push_back(ckA);
+        frame.push_back(ckB);
+        return frame;
+    }
+
+    std::vector<uint8_t> EncodeCFGPRT(uint32_t baudRate, uint8_t portID) {
+        std::vector<uint8_t> payload;
+        payload.reserve(20);
+        payload.push_back(portID);
+        payload.push_back(0); // reserved
+        putLE16(payload, 0); // txReady disabled
+        putLE32(payload, 0x000008d0); // mode: 8 data bits, no parity, 1 stop bit
+        putLE32(payload, baudRate);
+        putLE16(payload, 0x0003); // inProtoMask: UBX and NMEA
+        putLE16(payload, 0x0003); // outProtoMask: UBX and NMEA
+        putLE16(payload, 0); // flags
+        putLE16(payload, 0); // reserved
+        return EncodeUBX(UBX_CLASS_CFG, UBX_ID_CFG_PRT, payload);
+    }
+
+    std::vector<uint8_t> EncodeCFGMSG(uint8_t messageClass, uint8_t messageID, uint8_t rate) {
+        return EncodeUBX(UBX_CLASS_CFG, UBX_ID_CFG_MSG, {messageClass, messageID, rate});
+    }
+
+    std::vector<uint8_t> EncodeCFGRATE(uint16_t measurementPeriod, uint16_t navigationRate, uint16_t timeReference) {
+        std::vector<uint8_t> payload;
+        payload.reserve(6);
+        putLE16(payload, measurementPeriod);
+        putLE16(payload, navigationRate);
+        putLE16(payload, timeReference);
+        return EncodeUBX(UBX_CLASS_CFG, UBX_ID_CFG_RATE, payload);
+    }
+
+    size_t EstimatedSentenceBytes(SentenceType type) {
+        /* indexed by SentenceType; TXT is only output at start-up */
+        static constexpr std::array<size_t, SENTENCE_TYPE_COUNT> BYTES = {
+                80, // GGA
+                40, // VTG
+                4 * 70, // GSV: up to 16 satellites per constellation
+                52, // GLL
+                38, // ZDA
+                0, // TXT
+                72, // RMC
+                2 * 66, // GSA: one per constellation
+        };
+        return BYTES[type];
+    }
+
+    uint8_t NMEAMessageID(SentenceType type) {
+        /* indexed by SentenceType, from the u-blox M8 protocol specification */
+        static constexpr std::array<uint8_t, SENTENCE_TYPE_COUNT> IDS = {
+                0x00, // GGA
+                0x05, // VTG
+                0x03, // GSV
+                0x01, // GLL
+                0x08, // ZDA
+                0x41, // TXT
+                0x04, // RMC
+                0x02, // GSA
+        };
+        return IDS[type];
+    }
+
+    ParseStatus DecodeUBX(const uint8_t *data, size_t length, UBXFrame &frame) {
+        if (length < UBX_FRAME_OVERHEAD || data[0] != UBX_SYNC_1 || data[1] != UBX_SYNC_2) {
+            return PARSE_INVALID_SENTENCE;
+        }
+        size_t payloadLength = data[4] | (data[5] << 8);
+        if (length != payloadLength + UBX_FRAME_OVERHEAD) {
+            return PARSE_INVALID_SENTENCE;
+        }
+        uint8_t ckA, ckB;
+        UBXChecksum(data + 2, payloadLength + 4, ckA, ckB);
+        if (ckA != data[length - 2] || ckB != data[length - 1]) {
+            return PARSE_CHECKSUM_MISMATCH;
+        }
+        frame.Class = data[2];
+        frame.ID = data[3];
+        frame.Payload = data + UBX_HEADER_LENGTH;
+        frame.PayloadLength = payloadLength;
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseNavPVT(const UBXFrame &frame, NavPVTView &view) {
+        if (frame.Class != UBX_CLASS_NAV || frame.ID != UBX_ID_NAV_PVT) {
+            return PARSE_NO_MATCHING_TYPE;
+        }
+        if (frame.PayloadLength != NAV_PVT_LENGTH) {
+            return PARSE_INVALID_SENTENCE;
+        }
+        view = NavPVTView(frame.Payload);
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseNavPVT(const uint8_t *data, size_t length, NavPVTView &view) {
+        UBXFrame frame;
+        auto status = DecodeUBX(data, length, frame);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        return TryParseNavPVT(frame, view);
+    }
+
+    void NeoM8N::updateRegistry(const std::function<void(callbackRegistry &)> &update) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto next = std::make_shared<callbackRegistry>(*std::atomic_load(&registry));
+        update(*next);
+        std::atomic_store(&registry, std::shared_ptr<const callbackRegistry>(std::move(next)));
+        registryVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    void NeoM8N::RegisterCallback(const std::string &key, SentenceCallback cb) {
+        updateRegistry([&](callbackRegistry &r) {
+            setKeyed(r.Callbacks, key, std::move(cb));
+        });
+    }
+
+    void NeoM8N::RegisterCallback(const std::string &key, GPSCallback cb) {
+        RegisterCallback(key, SentenceCallback([cb = std::move(cb)](std::string_view sentence) {
+            cb(string(sentence));
+        }));
+    }
+
+    void NeoM8N::DeregisterCallback(const std::string &key) {
+        updateRegistry([&](callbackRegistry &r) {
+            eraseKeyed(r.Callbacks, key);
+        });
+    }
+
+    void NeoM8N::RegisterUBXCallback(const std::string &key, UBXCallback cb) {
+        updateRegistry([&](callbackRegistry &r) {
+            setKeyed(r.UBXCallbacks, key, std::move(cb));
+        });
+    }
+
+    void NeoM8N::DeregisterUBXCallback(const std::string &key) {
+        updateRegistry([&](callbackRegistry &r) {
+            eraseKeyed(r.UBXCallbacks, key);
+        });
+    }
+
+    void NeoM8N::Unsubscribe(const std::string &key) {
+        updateRegistry([&](callbackRegistry &r) {
+            for (auto &groups : r.Subscriptions) {
+                for (auto &g : groups) {
+                    g = g->Without(key);
+                }
+                groups.erase(std::remove(groups.begin(), groups.end(), nullptr), groups.end());
+            }
+        });
+    }
+
+    void NeoM8N::dispatch(const callbackRegistry &r, std::string_view sentence) {
+        // execute all callbacks
+        for (auto const &v : r.Callbacks) {
+            v.second(sentence);
+        }
+        SentenceType t;
+        if (TryGetSentenceType(sentence, t) != PARSE_OK) {
+            return;
+        }
+        for (auto const &g : r.Subscriptions[t]) {
+            g->Dispatch(sentence);
+        }
+    }
+
+    void NeoM8N::dispatchUBX(const callbackRegistry &r, const UBXFrame &frame) {
+        for (auto const &v : r.UBXCallbacks) {
+            v.second(frame);
+        }
+    }
+
+    void NeoM8N::deliverUBX(const uint8_t *data, size_t length, dispatchQueue *queue,
+                            std::shared_ptr<const callbackRegistry> &snapshot, uint64_t &snapshotVersion) {
+        UBXFrame frame;
+        if (DecodeUBX(data, length, frame) != PARSE_OK) {
+            rejectedSentences++;
+            return;
+        }
+        /* acknowledgements are handled on the Read thread, so that they do not wait behind queued sentences */
+        if (frame.Class == UBX_CLASS_ACK) {
+            acknowledge(frame);
+        }
+        if (queue) {
+            enqueue(*queue, std::string_view(reinterpret_cast<const char *>(data), length), true);
+            return;
+        }
+        refreshSnapshot(snapshot, snapshotVersion);
+        dispatchUBX(*snapshot, frame);
+    }
+
+    void NeoM8N::refreshSnapshot(std::shared_ptr<const callbackRegistry> &snapshot, uint64_t &snapshotVersion) const {
+        /* the common path is a single atomic load; the registry is only reloaded after a change */
+        auto version = registryVersion.load(std::memory_order_acquire);
+        if (!snapshot || version != snapshotVersion) {
+            snapshot = std::atomic_load(&registry);
+            snapshotVersion = version;
+        }
+    }
+
+    void NeoM8N::SetDispatchQueue(size_t capacity, OverflowPolicy policy) {
+        overflowPolicy = policy;
+        queueCapacity = capacity;
+    }
+
+    uint64_t NeoM8N::DroppedSentences() const {
+        return droppedSentences;
+    }
+
+    void NeoM8N::enqueue(dispatchQueue &q, std::string_view data, bool ubx) {
+        /* the framer discards anything longer than a slot */
+        queuedSentence item;
+        item.Length = static_cast<uint16_t>(data.size());
+        item.UBX = ubx;
+        std::memcpy(item.Data.data(), data.data(), item.Length);
+        switch (overflowPolicy.load()) {
+            case OVERFLOW_DROP_OLDEST:
+                if (!q.Queue.PushOverwrite(item)) {
+                    droppedSentences++;
+                }
+                break;
+            case OVERFLOW_DROP_NEWEST:
+                if (!q.Queue.TryPush(item)) {
+                    droppedSentences++;
+                    return;
+                }
+                break;
+            case OVERFLOW_BLOCK:
+                while (!q.Queue.TryPush(item)) {
+                    /* don't hold up Stop behind a stalled consumer */
+                    if (stopRequested) {
+                        droppedSentences++;
+                        return;
+                    }
+                    q.Wait([&] { return !q.Queue.Full() || stopRequested; });
+                }
+                break;
+        }
+        q.Notify();
+    }
+
+    void NeoM8N::dispatchLoop(dispatchQueue &q) {
+        std::shared_ptr<const callbackRegistry> snapshot;
+        uint64_t snapshotVersion = 0;
+        queuedSentence item;
+        while (true) {
+            if (q.Queue.TryPop(item)) {
+                /* Read may be waiting for room */
+                q.Notify();
+                refreshSnapshot(snapshot, snapshotVersion);
+                if (item.UBX) {
+                    UBXFrame frame;
+                    DecodeUBX(reinterpret_cast<const uint8_t *>(item.Data.data()), item.Length, frame);
+                    dispatchUBX(*snapshot, frame);
+                } else {
+                    dispatch(*snapshot, std::string_view(item.Data.data(), item.Length));
+                }
+                continue;
+            }
+            /* Done is only set after the last push, so an empty queue seen after it stays empty */
+            if (q.Done) {
+                if (q.Queue.Empty()) {
+                    return;
+                }
+                continue;
+            }
+            q.Wait([&] { return !q.Queue.Empty() || q.Done; });
+        }
+    }
+
+    void NeoM8N::Read() {
+        SentenceFramer framer;
+        std::shared_ptr<const callbackRegistry> snapshot;
+        uint64_t snapshotVersion = 0;
+        struct pollfd fds[2] = {{source->Fd(), POLLIN, 0},
+                                {wakeReadFd, POLLIN, 0}};
+        std::lock_guard<std::mutex> lock(readMutex);
+        std::unique_ptr<dispatchQueue> queue;
+        std::thread dispatcher;
+        if (auto capacity = queueCapacity.load()) {
+            queue = std::make_unique<dispatchQueue>(capacity);
+            dispatcher = std::thread(&NeoM8N::dispatchLoop, this, std::ref(*queue));
+            std::lock_guard<std::mutex> queueLock(activeQueueMutex);
+            activeQueue = queue.get();
+        }
+        /* lets the dispatch thread drain the queue and joins it on every way out of Read */
+        struct dispatcherGuard {
+            ~dispatcherGuard() {
+                if (Dispatcher.joinable()) {
+                    Queue->Done = true;
+                    Queue->Notify();
+                    Dispatcher.join();
+                    std::lock_guard<std::mutex> queueLock(Receiver.activeQueueMutex);
+                    Receiver.activeQueue = nullptr;
+                }
+            }
+
+            NeoM8N &Receiver;
+            std::thread &Dispatcher;
+            std::unique_ptr<dispatchQueue> &Queue;
+        } guard{*this, dispatcher, queue};
+        while (true) {
+            /* consume the stop request, so that a later Read starts afresh */
+            if (stopRequested.exchange(false)) {
+                return;
+            }
+            /* sleep in the kernel until data arrives, we are woken up or a command times out */
+            if (poll(fds, 2, commandTimeout()) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                clog << "ERROR: " << strerror(errno) << endl;
+                return;
+            }
+            if (fds[1].revents & POLLIN) {
+                /* drain the wake-up descriptor, then re-check the stop flag */
+                drainWakeup(wakeReadFd);
+                continue;
+            }
+            /* on a hang-up, read what is left until the end of the stream */
+            if (!(fds[0].revents & (POLLIN | POLLHUP))) {
+                if (fds[0].revents & (POLLERR | POLLNVAL)) {
+                    clog << "ERROR: device closed or in error" << endl;
+                    return;
+                }
+                continue;
+            }
+            auto region = framer.WritableRegion();
+            auto res = read(source->Fd(), region.first, region.second);
+            if (res == -1) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    continue;
+                } else {
+                    clog << "ERROR: " << strerror(errno) << endl;
+                    return;
+                }
+            }
+            if (res == 0) {
+                /* end of file, or the other end of a pipe or socket has been closed */
+                return;
+            }
+            framer.Commit(res, [&](std::string_view sentence) {
+                if (!ValidChecksum(sentence)) {
+                    rejectedSentences++;
+                    return;
+                }
+                if (queue) {
+                    enqueue(*queue, sentence, false);
+                    return;
+                }
+                // execute all callbacks
+                refreshSnapshot(snapshot, snapshotVersion);
+                dispatch(*snapshot, sentence);
+            }, [&](const uint8_t *frame, size_t length) {
+                deliverUBX(frame, length, queue.get(), snapshot, snapshotVersion);
+            });
+        }
+    }
+
+    uint64_t NeoM8N::RejectedSentences() const {
+        return rejectedSentences;
+    }
+
+    void NeoM8N::Stop() {
+        stopRequested = true;
+        wake();
+        /* Read may be waiting for room in the dispatch queue rather than in poll() */
+        std::lock_guard<std::mutex> queueLock(activeQueueMutex);
+        if (activeQueue) {
+            activeQueue->Notify();
+        }
+    }
+
+    NeoM8N::~NeoM8N() {
+        /* stop capturing and wait for a running Read to return */
+        Stop();
+        std::lock_guard<std::mutex> lock(readMutex);
+        /* nothing can answer the outstanding commands any more */
+        expireCommands(std::chrono::steady_clock::time_point::max());
+        /* the source closes the port */
+        closeWakeup(wakeReadFd, wakeWriteFd);
+    }
+
+#if defined(__linux__)
+    namespace {
+        class epollBackend : public ReadBackend {
+        public:
+            epollBackend() {
+                epollFd = epoll_create1(EPOLL_CLOEXEC);
+                if (epollFd < 0) {
+                    perror("epoll_create1");
+                    return;
+                }
+                if (!openWakeup(wakeReadFd, wakeWriteFd)) {
+                    close(epollFd);
+                    epollFd = -1;
+                    return;
+                }
+                /* the wake-up descriptor is registered with a null pointer */
+                struct epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.ptr = nullptr;
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeReadFd, &ev);
+            }
+
+            ~epollBackend() override {
+                if (epollFd >= 0) {
+                    close(epollFd);
+                    closeWakeup(wakeReadFd, wakeWriteFd);
+                }
+            }
+
+            bool Valid() const {
+                return epollFd >= 0;
+            }
+
+            bool Add(int fd, void *token) override {
+                std::lock_guard<std::mutex> lock(mutex);
+                entries.push_back(std::make_unique<entry>(entry{fd, token}));
+                struct epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.ptr = entries.back().get();
+                if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                    clog << "ERROR: " << strerror(errno) << endl;
+                    entries.pop_back();
+                    return false;
+                }
+                return true;
+            }
+
+            bool Wait(const ReadHandler &onRead) override {
+                struct epoll_event events[64];
+                systemCalls++;
+                auto n = epoll_wait(epollFd, events, 64, -1);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        return true;
+                    }
+                    clog << "ERROR: " << strerror(errno) << endl;
+                    return false;
+                }
+                for (int i = 0; i < n; i++) {
+                    auto e = static_cast<entry *>(events[i].data.ptr);
+                    if (e == nullptr) {
+                        drainWakeup(wakeReadFd);
+                        continue;
+                    }
+                    /* level-triggered: whatever does not fit into the buffer is reported again by the next wait */
+                    systemCalls++;
+                    auto res = read(e->Fd, buffer.data(), buffer.size());
+                    if (res < 0 && (errno == EAGAIN || errno == EINTR)) {
+                        continue;
+                    }
+                    if (res <= 0) {
+                        auto err = res < 0 ? -errno : 0;
+                        epoll_ctl(epollFd, EPOLL_CTL_DEL, e->Fd, nullptr);
+                        onRead(e->Token, nullptr, err);
+                        continue;
+                    }
+                    onRead(e->Token, buffer.data(), res);
+                }
+                return true;
+            }
+
+            void Wake() override {
+                signalWakeup(wakeWriteFd);
+            }
+
+            const char *Name() const override {
+                return "epoll";
+            }
+
+            uint64_t SystemCalls() const override {
+                return systemCalls;
+            }
+
+        private:
+            struct entry {
+                int Fd;
+                void *Token;
+            };
+
+            int epollFd;
+            int wakeReadFd = -1;
+            int wakeWriteFd = -1;
+            // the entries never move, so epoll can hold pointers to them
+            std::vector<std::unique_ptr<entry>> entries;
+            std::mutex mutex;
+            std::array<char, SentenceFramer::BUFFER_SIZE> buffer{};
+            std::atomic<uint64_t> systemCalls{0};
+        };
+
+#if defined(NEOM8N_IO_URING)
+        /**
+         * ioUringBackend keeps a poll request linked to a read request outstanding for every descriptor: the read
+         * goes into a slot of a registered buffer as soon as the poll reports data, so neither needs a system call of
+         * its own. Wait re-arms the completed requests and submits them in the same io_uring_enter that waits for the
+         * next completion. The ring is set up with raw system calls, so liburing is not needed.
+         */
+        class ioUringBackend : public ReadBackend {
+        public:
+            // the size of each descriptor's slot in the registered buffer
+            static constexpr size_t SLOT_SIZE = 1024;
+
+            explicit ioUringBackend(size_t maxDescriptors) : slots(maxDescriptors + 1) {
+                if (!openWakeup(wakeReadFd, wakeWriteFd)) {
+                    return;
+                }
+                if (!setup(static_cast<unsigned>(2 * slots.size()))) {
+                    teardown();
+                    return;
+                }
+                /* slot 0 reads the wake-up descriptor */
+                slots[0].Fd = wakeReadFd;
+                arm(0);
+            }
+
+            ~ioUringBackend() override {
+                teardown();
+            }
+
+            bool Valid() const {
+                return ringFd >= 0;
+            }
+
+            bool Add(int fd, void *token) override {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    size_t i = 1;
+                    while (i < slots.size() && slots[i].Fd >= 0) {
+                        i++;
+                    }
+                    if (i == slots.size()) {
+                        clog << "ERROR: io_uring backend is limited to " << slots.size() - 1 << " descriptors" << endl;
+                        return false;
+                    }
+                    slots[i].Fd = fd;
+                    slots[i].Token = token;
+                    /* the ring is only touched by the waiting thread, which arms the slot */
+                    pending.push_back(i);
+                }
+                Wake();
+                return true;
+            }
+
+            bool Wait(const ReadHandler &onRead) override {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (auto i : pending) {
+                        arm(i);
+                    }
+                    pending.clear();
+                }
+                systemCalls++;
+                auto res = syscall(__NR_io_uring_enter, ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (res < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                        return true;
+                    }
+                    clog << "ERROR: " << strerror(errno) << endl;
+                    return false;
+                }
+                unsubmitted -= static_cast<unsigned>(res);
+                auto head = *cqHead;
+                auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; head++) {
+                    auto &cqe = cqes[head & *cqMask];
+                    complete(cqe.user_data, cqe.res, onRead);
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                return true;
+            }
+
+            void Wake() override {
+                signalWakeup(wakeWriteFd);
+            }
+
+            const char *Name() const override {
+                return "io_uring";
+            }
+
+            uint64_t SystemCalls() const override {
+                return systemCalls;
+            }
+
+        private:
+            struct slot {
+                int Fd = -1;
+                void *Token = nullptr;
+                // the error of a failed poll request, reported when its linked read is cancelled
+                int PollError = 0;
+            };
+
+            bool setup(unsigned entries) {
+                struct io_uring_params params{};
+                ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (ringFd < 0) {
+                    return false;
+                }
+                /* fast poll arrived together with all the requests used here */
+                if (!(params.features & IORING_FEAT_FAST_POLL)) {
+                    return false;
+                }
+                skipPollCompletions = params.features & IORING_FEAT_CQE_SKIP;
+                sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+                bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (singleMap) {
+                    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+                }
+                sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                              IORING_OFF_SQ_RING);
+                if (sqRing == MAP_FAILED) {
+                    sqRing = nullptr;
+                    return false;
+                }
+                if (singleMap) {
+                    cqRing = sqRing;
+                } else {
+                    cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                  IORING_OFF_CQ_RING);
+                    if (cqRing == MAP_FAILED) {
+                        cqRing = nullptr;
+                        return false;
+                    }
+                }
+                sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+                auto sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                    IORING_OFF_SQES);
+                if (sqesMap == MAP_FAILED) {
+                    return false;
+                }
+                sqes = static_cast<struct io_uring_sqe *>(sqesMap);
+                auto sq = static_cast<char *>(sqRing);
+                sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+                auto cq = static_cast<char *>(cqRing);
+                cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+                sqLocalTail = *sqTail;
+                /* one registered buffer, of which every descriptor has a slot */
+                buffer.reset(new char[slots.size() * SLOT_SIZE]);
+                struct iovec iov = {buffer.get(), slots.size() * SLOT_SIZE};
+                if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+                    clog << "ERROR: io_uring buffer registration failed: " << strerror(errno) << endl;
+                    return false;
+                }
+                return true;
+            }
+
+            void teardown() {
+                if (sqes != nullptr) {
+                    munmap(sqes, sqesSize);
+                }
+                if (cqRing != nullptr && cqRing != sqRing) {
+                    munmap(cqRing, cqRingSize);
+                }
+                if (sqRing != nullptr) {
+                    munmap(sqRing, sqRingSize);
+                }
+                /* closing the ring cancels the outstanding requests */
+                if (ringFd >= 0) {
+                    close(ringFd);
+                }
+                if (wakeReadFd >= 0) {
+                    closeWakeup(wakeReadFd, wakeWriteFd);
+                }
+                sqes = nullptr;
+                sqRing = cqRing = nullptr;
+                ringFd = wakeReadFd = wakeWriteFd = -1;
+            }
+
+            // there is always room: each slot has at most two requests outstanding, and the ring has two per slot
+            struct io_uring_sqe *nextSqe() {
+                auto index = sqLocalTail & *sqMask;
+                auto sqe = &sqes[index];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqArray[index] = index;
+                sqLocalTail++;
+                unsubmitted++;
+                return sqe;
+            }
+
+            // queues a poll request and the read linked to it; user_data holds the slot and whether it is the poll
+            void arm(size_t i) {
+                auto poll = nextSqe();
+                poll->opcode = IORING_OP_POLL_ADD;
+                poll->fd = slots[i].Fd;
+                poll->poll32_events = POLLIN;
+                poll->flags = IOSQE_IO_LINK | (skipPollCompletions ? IOSQE_CQE_SKIP_SUCCESS : 0);
+                poll->user_data = (i << 1) | 1;
+                auto rd = nextSqe();
+                rd->fd = slots[i].Fd;
+                rd->off = static_cast<uint64_t>(-1);
+                rd->user_data = i << 1;
+                if (i == 0) {
+                    rd->opcode = IORING_OP_READ;
+                    rd->addr = reinterpret_cast<uint64_t>(&wakeups);
+                    rd->len = sizeof(wakeups);
+                } else {
+                    rd->opcode = IORING_OP_READ_FIXED;
+                    rd->addr = reinterpret_cast<uint64_t>(buffer.get() + i * SLOT_SIZE);
+                    rd->len = SLOT_SIZE;
+                    rd->buf_index = 0;
+                }
+                __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+            }
+
+            void complete(uint64_t userData, int res, const ReadHandler &onRead) {
+                auto i = static_cast<size_t>(userData >> 1);
+                auto &s = slots[i];
+                if (userData & 1) {
+                    /* a poll request only completes on its own if it failed, or if its completions are not skipped */
+                    s.PollError = res < 0 ? res : 0;
+                    return;
+                }
+                if (res == -ECANCELED && s.PollError < 0) {
+                    res = s.PollError;
+                }
+                if (i == 0 || res > 0 || res == -EAGAIN || res == -EINTR) {
+                    if (i != 0 && res > 0) {
+                        onRead(s.Token, buffer.get() + i * SLOT_SIZE, res);
+                    }
+                    arm(i);
+                    return;
+                }
+                auto token = s.Token;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    s = slot();
+                }
+                onRead(token, nullptr, res);
+            }
+
+            std::vector<slot> slots;
+            // slots added by Add, to be armed by the waiting thread
+            std::vector<size_t> pending;
+            std::mutex mutex;
+            std::unique_ptr<char[]> buffer;
+            uint64_t wakeups = 0;
+            int wakeReadFd = -1;
+            int wakeWriteFd = -1;
+            int ringFd = -1;
+            bool skipPollCompletions = false;
+            void *sqRing = nullptr;
+            void *cqRing = nullptr;
+            size_t sqRingSize = 0;
+            size_t cqRingSize = 0;
+            struct io_uring_sqe *sqes = nullptr;
+            size_t sqesSize = 0;
+            unsigned *sqTail = nullptr;
+            unsigned *sqMask = nullptr;
+            unsigned *sqArray = nullptr;
+            unsigned *cqHead = nullptr;
+            unsigned *cqTail = nullptr;
+            unsigned *cqMask = nullptr;
+            struct io_uring_cqe *cqes = nullptr;
+            unsigned sqLocalTail = 0;
+            // queued requests that have not been handed to the kernel yet
+            unsigned unsubmitted = 0;
+            std::atomic<uint64_t> systemCalls{0};
+        };
+#endif
+    }
+
+    std::unique_ptr<ReadBackend> MakeReadBackend(ReadBackendType type, size_t maxDescriptors) {
+#if defined(NEOM8N_IO_URING)
+        if (type != READ_BACKEND_EPOLL) {
+            auto uring = std::make_unique<ioUringBackend>(maxDescriptors);
+            if (uring->Valid()) {
+                return uring;
+            }
+            if (type == READ_BACKEND_IO_URING) {
+                return nullptr;
+            }
+        }
+#else
+        /* built without the io_uring backend */
+        (void) maxDescriptors;
+        if (type == READ_BACKEND_IO_URING) {
+            return nullptr;
+        }
+#endif
+        auto epoll = std::make_unique<epollBackend>();
+        if (!epoll->Valid()) {
+            return nullptr;
+        }
+        return epoll;
+    }
+
+    ReceiverGroup::ReceiverGroup(ReceiverCallback callback, unsigned int threads, bool pinThreads,
+                                 ReadBackendType backend, size_t expectedReceivers)
+            : callback(std::move(callback)), pinThreads(pinThreads) {
+        threads = std::max(threads, 1u);
+        /* the receivers are assigned round-robin, so no thread gets more than its share */
+        auto perThread = std::max(DEFAULT_MAX_DESCRIPTORS, (expectedReceivers + threads - 1) / threads);
+        for (unsigned int i = 0; i < threads; i++) {
+            shards.push_back(MakeReadBackend(backend, perThread));
+            if (!shards.back()) {
+                throw DeviceError("read backend not supported");
+            }
+        }
+    }
+
+    ReceiverGroup::~ReceiverGroup() {
+        /* stop and wait for a running Run to return */
+        Stop();
+        std::lock_guard<std::mutex> lock(runMutex);
+        /* the backends go first, as they may still have requests outstanding on the ports */
+        shards.clear();
+        receivers.clear();
+    }
+
+    int ReceiverGroup::AddReceiver(std::unique_ptr<ByteSource> source) {
+        std::lock_guard<std::mutex> lock(receiversMutex);
+        auto r = std::make_unique<receiver>();
+        r->Id = static_cast<int>(receivers.size());
+        r->Source = std::move(source);
+        /* a full io_uring thread passes the receiver on to the next one */
+        size_t i = 0;
+        while (i < shards.size() && !shards[(r->Id + i) % shards.size()]->Add(r->Source->Fd(), r.get())) {
+            i++;
+        }
+        if (i == shards.size()) {
+            return -1;
+        }
+        receivers.push_back(std::move(r));
+        return receivers.back()->Id;
+    }
+
+    int ReceiverGroup::AddReceiver(const std::string &device, unsigned int baudRate) {
+        std::unique_ptr<ByteSource> source;
+        try {
+            source = std::make_unique<SerialSource>(device, baudRate);
+        } catch (const DeviceError &e) {
+            clog << "ERROR: " << e.what() << endl;
+            return -1;
+        }
+        return AddReceiver(std::move(source));
+    }
+
+    int ReceiverGroup::AddReceiver(int fd) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        return AddReceiver(std::make_unique<DescriptorSource>(fd));
+    }
+
+    void ReceiverGroup::Run() {
+        std::lock_guard<std::mutex> lock(runMutex);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < shards.size(); i++) {
+            threads.emplace_back(&ReceiverGroup::runShard, this, i);
+        }
+        runShard(0);
+        for (auto &t : threads) {
+            t.join();
+        }
+        /* consume the stop request only once all reactor threads have seen it */
+        stopRequested = false;
+    }
+
+    void ReceiverGroup::Stop() {
+        stopRequested = true;
+        for (auto &s : shards) {
+            s->Wake();
+        }
+    }
+
+    uint64_t ReceiverGroup::RejectedSentences() const {
+        return rejectedSentences;
+    }
+
+    void ReceiverGroup::runShard(size_t index) {
+        auto &backend = *shards[index];
+        if (pinThreads) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(index % std::max(std::thread::hardware_concurrency(), 1u), &cpus);
+            auto err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+            if (err != 0) {
+                clog << "ERROR: " << strerror(err) << endl;
+            }
+        }
+        auto onRead = [&](void *token, const char *data, ssize_t length) {
+            auto r = static_cast<receiver *>(token);
+            if (length <= 0) {
+                /* the backend has already dropped the port */
+                clog << "ERROR: receiver " << r->Id << " closed or in error" << endl;
+                return;
+            }
+            r->Framer.Push(data, length, [&](std::string_view sentence) {
+                if (!ValidChecksum(sentence)) {
+                    rejectedSentences++;
+                    return;
+                }
+                callback(r->Id, sentence);
+            });
+        };
+        while (!stopRequested) {
+            if (!backend.Wait(onRead)) {
+                return;
+            }
+        }
+    }
+#endif
+
+    namespace {
+        const std::string_view WHITESPACE = "\t\n\v\f\r ";
+
+        bool isDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        bool isUpper(char c) {
+            return c >= 'A' && c <= 'Z';
+        }
+
+        bool isHex(char c) {
+            return isDigit(c) || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+        }
+
+        // [0-9]+
+        bool isDigits(std::string_view f) {
+            if (f.empty()) return false;
+            for (auto c : f) {
+                if (!isDigit(c)) return false;
+            }
+            return true;
+        }
+
+        // [0-9]*
+        bool isOptionalDigits(std::string_view f) {
+            return f.empty() || isDigits(f);
+        }
+
+        // [0-9]+[.][0-9]+
+        bool isDecimal(std::string_view f) {
+            auto dot = f.find('.');
+            return dot != std::string_view::npos && isDigits(f.substr(0, dot)) && isDigits(f.substr(dot + 1));
+        }
+
+        // [-]?[0-9]+[.][0-9]+
+        bool isSignedDecimal(std::string_view f) {
+            return isDecimal(!f.empty() && f[0] == '-' ? f.substr(1) : f);
+        }
+
+        // hhmmss.ss
+        bool isTime(std::string_view f) {
+            return f.size() > 7 && isDigits(f.substr(0, 6)) && f[6] == '.' && isDigits(f.substr(7));
+        }
+
+        // a single character out of the given set
+        bool isOneOf(std::string_view f, std::string_view chars) {
+            return f.size() == 1 && chars.find(f[0]) != std::string_view::npos;
         }
-        tcgetattr(fd, &oldPortSettings); /* save current serial port settings */
-        bzero(&newPortSettings, sizeof(newPortSettings)); /* clear struct for new port settings */
-        fcntl(fd, F_GETFL, 0);
-        fcntl(fd, F_SETFL, O_NONBLOCK);
-        /*
-           BAUDRATE: Set bps rate. You could also use cfsetispeed and cfsetospeed.
-           CRTSCTS : output hardware flow control (only used if the cable has
-                     all necessary lines. See sect. 7 of Serial-HOWTO)
-           CS8     : 8n1 (8bit,no parity,1 stopbit)
-           CLOCAL  : local connection, no modem contol
-           CREAD   : enable receiving characters
+
+        /**
+         * trimSentence strips everything before the start delimiter and any trailing whitespace.
+         * @return an empty view if there is no start delimiter
          */
-        newPortSettings.c_cflag = B9600 | CRTSCTS | CS8 | CLOCAL | CREAD;
-        /*
-          IGNPAR  : ignore bytes with parity errors
-          ICRNL   : map CR to NL (otherwise a CR input on the other computer
-                    will not terminate input)
-          otherwise make device raw (no other input processing)
-        */
-        newPortSettings.c_iflag = IGNPAR | ICRNL;
-        /*
-         Raw output.
-        */
-        newPortSettings.c_oflag = 0;
-        /*
-          ICANON  : enable canonical input
-          disable all echo functionality, and don't send signals to calling program
-        */
-        newPortSettings.c_lflag = ICANON;
-        /*
-          initialize all control characters
-          default values can be found in /usr/include/termios.h, and are given
-          in the comments, but we don't need them here
-        */
-        newPortSettings.c_cc[VINTR] = 0;     /* Ctrl-c */
-        newPortSettings.c_cc[VQUIT] = 0;     /* Ctrl-\ */
-        newPortSettings.c_cc[VERASE] = 0;     /* del */
-        newPortSettings.c_cc[VKILL] = 0;     /* @ */
-        newPortSettings.c_cc[VEOF] = 4;     /* Ctrl-d */
-        newPortSettings.c_cc[VTIME] = 0;     /* inter-character timer unused */
-        newPortSettings.c_cc[VMIN] = 1;     /* blocking read until 1 character arrives */
-        newPortSettings.c_cc[/*VSWTC*/7] = 0;     /* '\0' */
-        newPortSettings.c_cc[VSTART] = 0;     /* Ctrl-q */
-        newPortSettings.c_cc[VSTOP] = 0;     /* Ctrl-s */
-        newPortSettings.c_cc[VSUSP] = 0;     /* Ctrl-z */
-        newPortSettings.c_cc[VEOL] = 0;     /* '\0' */
-        newPortSettings.c_cc[VREPRINT] = 0;     /* Ctrl-r */
-        newPortSettings.c_cc[VDISCARD] = 0;     /* Ctrl-u */
-        newPortSettings.c_cc[VWERASE] = 0;     /* Ctrl-w */
-        newPortSettings.c_cc[VLNEXT] = 0;     /* Ctrl-v */
-        newPortSettings.c_cc[VEOL2] = 0;     /* '\0' */
-        /*
-          now clean the modem line and activate the settings for the port
-        */
-        tcflush(fd, TCIFLUSH);
-        tcsetattr(fd, TCSANOW, &newPortSettings);
+        std::string_view trimSentence(std::string_view s) {
+            auto start = s.find('$');
+            if (start == std::string_view::npos) return {};
+            auto end = s.find_last_not_of(WHITESPACE);
+            return s.substr(start, end - start + 1);
+        }
+
+        /**
+         * sentenceFormatter validates the address ("$TTFFF") and checksum ("*hh") parts of a sentence, without
+         * looking at the fields in between.
+         * @return the three character formatter, or an empty view if the sentence is malformed
+         */
+        std::string_view sentenceFormatter(std::string_view sentence) {
+            auto s = trimSentence(sentence);
+            if (s.size() < 6) return {};
+            for (size_t i = 1; i < 6; i++) {
+                if (!isUpper(s[i])) return {};
+            }
+            auto star = s.rfind('*');
+            if (star == std::string_view::npos || star < 6 || star + 1 == s.size()) return {};
+            for (auto i = star + 1; i < s.size(); i++) {
+                if (!isHex(s[i])) return {};
+            }
+            return s.substr(3, 3);
+        }
+
+        struct formatterEntry {
+            uint32_t code;
+            SentenceType type;
+        };
+
+        // to support a new sentence type, add it to SentenceType and to this table
+        constexpr formatterEntry FORMATTERS[] = {
+                {FormatterCode("GGA"), GGA_TYPE},
+                {FormatterCode("VTG"), VTG_TYPE},
+                {FormatterCode("GSV"), GSV_TYPE},
+                {FormatterCode("GLL"), GLL_TYPE},
+                {FormatterCode("ZDA"), ZDA_TYPE},
+                {FormatterCode("TXT"), TXT_TYPE},
+                {FormatterCode("RMC"), RMC_TYPE},
+                {FormatterCode("GSA"), GSA_TYPE},
+        };
+
+        constexpr unsigned int FORMATTER_HASH_BITS = 4;
+        constexpr size_t FORMATTER_TABLE_SIZE = size_t(1) << FORMATTER_HASH_BITS;
+        static_assert(sizeof(FORMATTERS) / sizeof(FORMATTERS[0]) <= FORMATTER_TABLE_SIZE,
+                      "too many formatters for the hash table");
+
+        constexpr uint32_t formatterHash(uint32_t code, uint32_t multiplier) {
+            return static_cast<uint32_t>(code * multiplier) >> (32 - FORMATTER_HASH_BITS);
+        }
+
+        /**
+         * findFormatterMultiplier searches, at compile time, for a multiplicative hash under which no two formatters
+         * share a slot.
+         */
+        constexpr uint32_t findFormatterMultiplier() {
+            for (uint32_t multiplier = 0x9E3779B1; multiplier != 0x9E3779B1 + 2 * 100000; multiplier += 2) {
+                bool used[FORMATTER_TABLE_SIZE] = {};
+                bool perfect = true;
+                for (auto &e : FORMATTERS) {
+                    auto slot = formatterHash(e.code, multiplier);
+                    if (used[slot]) {
+                        perfect = false;
+                        break;
+                    }
+                    used[slot] = true;
+                }
+                if (perfect) return multiplier;
+            }
+            return 0;
+        }
+
+        constexpr uint32_t FORMATTER_MULTIPLIER = findFormatterMultiplier();
+        static_assert(FORMATTER_MULTIPLIER != 0, "no perfect hash found for the formatters");
+
+        constexpr std::array<formatterEntry, FORMATTER_TABLE_SIZE> buildFormatterTable() {
+            std::array<formatterEntry, FORMATTER_TABLE_SIZE> table{};
+            for (auto &e : FORMATTERS) {
+                table[formatterHash(e.code, FORMATTER_MULTIPLIER)] = e;
+            }
+            return table;
+        }
+
+        // empty slots have code 0, which no upper case formatter can produce
+        constexpr auto FORMATTER_TABLE = buildFormatterTable();
+
+        bool formatterToSentenceType(std::string_view s, SentenceType &t) {
+            if (s.size() != 3) return false;
+            auto code = FormatterCode(s[0], s[1], s[2]);
+            auto &e = FORMATTER_TABLE[formatterHash(code, FORMATTER_MULTIPLIER)];
+            if (e.code != code) return false;
+            t = e.type;
+            return true;
+        }
+
+        // parses the 1-2 hex digits following the checksum delimiter
+        bool parseChecksum(std::string_view f, uint8_t &checksum) {
+            if (f.empty() || f.size() > 2) return false;
+            unsigned int v = 0;
+            for (auto c : f) {
+                if (!isHex(c)) return false;
+                v = v * 16 + (isDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+            }
+            checksum = static_cast<uint8_t>(v);
+            return true;
+        }
+
+        /**
+         * tokenize splits a sentence into its fields in a single pass and verifies its checksum. The talker and
+         * formatter are set before the first field is handed to onField(index, field), so the callback can decode
+         * fields as they are found. Once onField rejects a field it is not called again, but the checksum is still
+         * verified so that corrupted sentences are reported as such.
+         */
+        template<typename F>
+        ParseStatus tokenize(std::string_view sentence, std::string_view &talker, std::string_view &formatter,
+                             std::string_view &checksum, size_t &count, F &&onField) {
+            auto s = trimSentence(sentence);
+            auto n = s.size();
+            if (n < 6) return PARSE_INVALID_SENTENCE;
+            for (size_t i = 1; i < 6; i++) {
+                if (!isUpper(s[i])) return PARSE_INVALID_SENTENCE;
+            }
+            talker = s.substr(1, 2);
+            formatter = s.substr(3, 3);
+            count = 0;
+            bool accepted = true;
+            size_t i = 6;
+            if (i < n && s[i] == ',') {
+                auto fieldStart = ++i;
+                for (; i < n && s[i] != '*'; i++) {
+                    if (s[i] == ',') {
+                        accepted = accepted && onField(count, s.substr(fieldStart, i - fieldStart));
+                        count++;
+                        fieldStart = i + 1;
+                    }
+                }
+                accepted = accepted && onField(count, s.substr(fieldStart, i - fieldStart));
+                count++;
+            }
+            if (i + 1 >= n || s[i] != '*') return PARSE_INVALID_SENTENCE;
+            checksum = s.substr(i + 1);
+            uint8_t expected;
+            if (!parseChecksum(checksum, expected)) return PARSE_INVALID_SENTENCE;
+            if (Checksum(s.substr(1, i - 1)) != expected) return PARSE_CHECKSUM_MISMATCH;
+            return accepted ? PARSE_OK : PARSE_INVALID_SENTENCE;
+        }
+
+        constexpr int64_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+                                     10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000,
+                                     1000000000000000, 10000000000000000, 100000000000000000};
+
+        /**
+         * parseFixed parses a decimal of the form [-]?[0-9]+[.][0-9]+ into an integer mantissa and the number of
+         * decimals, i.e. value = mantissa / 10^decimals. Unlike std::stod it is locale independent and does not
+         * allocate.
+         */
+        bool parseFixed(std::string_view f, bool allowSign, int64_t &mantissa, int &decimals) {
+            bool negative = allowSign && !f.empty() && f[0] == '-';
+            if (negative) f.remove_prefix(1);
+            auto dot = f.find('.');
+            // at most 17 digits fit into the mantissa without overflowing
+            if (dot == std::string_view::npos || dot == 0 || dot + 1 == f.size() || f.size() > 18) return false;
+            int64_t m = 0;
+            for (size_t i = 0; i < f.size(); i++) {
+                if (i == dot) continue;
+                if (!isDigit(f[i])) return false;
+                m = m * 10 + (f[i] - '0');
+            }
+            mantissa = negative ? -m : m;
+            decimals = static_cast<int>(f.size() - dot - 1);
+            return true;
+        }
+
+        bool parseFixed(std::string_view f, bool allowSign, double &value) {
+            int64_t m;
+            int d;
+            if (!parseFixed(f, allowSign, m, d)) return false;
+            value = static_cast<double>(m) / static_cast<double>(POW10[d]);
+            return true;
+        }
+
+        bool parseFixed(std::string_view f, bool allowSign, float &value) {
+            double d;
+            if (!parseFixed(f, allowSign, d)) return false;
+            value = static_cast<float>(d);
+            return true;
+        }
+
+        // parses a (d)ddmm.mmmm coordinate into decimal degrees
+        bool parseCoordinate(std::string_view f, double &degrees) {
+            int64_t m;
+            int d;
+            if (!parseFixed(f, false, m, d)) return false;
+            auto scale = POW10[d];
+            auto wholeDegrees = m / (100 * scale);
+            auto minutes = m - wholeDegrees * 100 * scale;
+            if (minutes >= 60 * scale) return false;
+            degrees = static_cast<double>(wholeDegrees) +
+                      static_cast<double>(minutes) / (60.0 * static_cast<double>(scale));
+            return true;
+        }
+
+        // parses hhmmss.ss into milliseconds since midnight
+        bool parseTimeOfDay(std::string_view f, uint32_t &ms) {
+            if (!isTime(f)) return false;
+            auto twoDigits = [&](size_t i) { return static_cast<uint32_t>((f[i] - '0') * 10 + (f[i + 1] - '0')); };
+            auto h = twoDigits(0), m = twoDigits(2), s = twoDigits(4);
+            // allow for a leap second
+            if (h > 23 || m > 59 || s > 60) return false;
+            uint32_t fraction = 0;
+            for (size_t i = 7; i < 10; i++) {
+                fraction = fraction * 10 + (i < f.size() ? f[i] - '0' : 0);
+            }
+            ms = ((h * 60 + m) * 60 + s) * 1000 + fraction;
+            return true;
+        }
+
+        bool parseSmallInt(std::string_view f, int &value) {
+            if (!isDigits(f) || f.size() > 9) return false;
+            value = 0;
+            for (auto c : f) {
+                value = value * 10 + (c - '0');
+            }
+            return true;
+        }
+
+        /**
+         * decodeGGAField validates and decodes field i of a GGA sentence into the fix. The hemisphere indicators
+         * follow their coordinates, so the sign is applied when the indicator is decoded.
+         */
+        bool decodeGGAField(GGAFix &fix, size_t i, std::string_view f) {
+            switch (i) {
+                case 0:
+                    return parseTimeOfDay(f, fix.TimeOfDay);
+                case 1:
+                    return parseCoordinate(f, fix.Latitude);
+                case 2:
+                    if (!isOneOf(f, "NS")) return false;
+                    if (f[0] == 'S') fix.Latitude = -fix.Latitude;
+                    return true;
+                case 3:
+                    return parseCoordinate(f, fix.Longitude);
+                case 4:
+                    if (!isOneOf(f, "EW")) return false;
+                    if (f[0] == 'W') fix.Longitude = -fix.Longitude;
+                    return true;
+                case 5:
+                    return isOneOf(f, "0126") && parseSmallInt(f, fix.QualityIndicator);
+                case 6:
+                    return f.size() == 2 && parseSmallInt(f, fix.NumberOfSatellitesUsed);
+                case 7:
+                    return parseFixed(f, false, fix.HDOP);
+                case 8:
+                    return parseFixed(f, true, fix.Altitude);
+                case 9:
+                    return f.empty() || f == "M";
+                case 10:
+                    return parseFixed(f, true, fix.GeoIDSeparation);
+                default:
+                    return true;
+            }
+        }
+
+        bool validGGA(const SentenceFields &f) {
+            auto &v = f.Values;
+            return f.Formatter == "GGA" && f.Count >= 13 &&
+                   isTime(v[0]) &&
+                   isDecimal(v[1]) && isOneOf(v[2], "NS") &&
+                   isDecimal(v[3]) && isOneOf(v[4], "EW") &&
+                   isOneOf(v[5], "0126") &&
+                   v[6].size() == 2 && isDigits(v[6]) &&
+                   isDecimal(v[7]) &&
+                   isSignedDecimal(v[8]) && (v[9].empty() || v[9] == "M") &&
+                   isSignedDecimal(v[10]);
+        }
+
+        /**
+         * validSatelliteInfo validates the four fields of a satellite (ID, elevation, azimuth and signal strength),
+         * starting at the given field.
+         */
+        bool validSatelliteInfo(const SentenceFields &f, size_t i) {
+            auto &v = f.Values;
+            return isDigits(v[i]) && isOptionalDigits(v[i + 1]) && isOptionalDigits(v[i + 2]) &&
+                   isOptionalDigits(v[i + 3]);
+        }
+
+        // an empty elevation or azimuth (a satellite whose position is not known yet) reads as 0
+        std::string_view orZero(std::string_view f) {
+            return f.empty() ? std::string_view("0") : f;
+        }
+
+        bool validGSV(const SentenceFields &f) {
+            if (f.Formatter != "GSV" || f.Count < 7) return false;
+            auto &v = f.Values;
+            if (!isDigits(v[0]) || !isDigits(v[1]) || !isDigits(v[2])) return false;
+            // the satellite infos may be followed by a signal ID (NMEA 4.1+)
+            auto satellites = (f.Count - 3) / 4;
+            auto remainder = (f.Count - 3) % 4;
+            if (satellites > 4 || remainder > 1) return false;
+            if (remainder == 1 && !isOptionalDigits(v[f.Count - 1])) return false;
+            for (size_t i = 0; i < satellites; i++) {
+                if (!validSatelliteInfo(f, 3 + i * 4)) return false;
+            }
+            return true;
+        }
+
+        // [0-9]{n}
+        bool isNDigits(std::string_view f, size_t n) {
+            return f.size() == n && isDigits(f);
+        }
+
+        // an empty field, or one accepted by the validator
+        template<typename P>
+        bool optional(std::string_view f, P valid) {
+            return f.empty() || valid(f);
+        }
+
+        bool validZDA(const SentenceFields &f) {
+            auto &v = f.Values;
+            return f.Formatter == "ZDA" && f.Count == 6 &&
+                   optional(v[0], isTime) &&
+                   optional(v[1], [](std::string_view d) { return isNDigits(d, 2); }) &&
+                   optional(v[2], [](std::string_view m) { return isNDigits(m, 2); }) &&
+                   optional(v[3], [](std::string_view y) { return isNDigits(y, 4); }) &&
+                   optional(v[4], [](std::string_view h) { return isNDigits(h[0] == '-' ? h.substr(1) : h, 2); }) &&
+                   optional(v[5], [](std::string_view m) { return isNDigits(m, 2); });
+        }
+
+        bool validGSA(const SentenceFields &f) {
+            auto &v = f.Values;
+            // 12 satellite ID fields, optionally followed by a system ID (NMEA 4.1+)
+            if (f.Formatter != "GSA" || f.Count < 17 || f.Count > 18) return false;
+            if (!optional(v[0], [](std::string_view m) { return isOneOf(m, "MA"); }) ||
+                !optional(v[1], [](std::string_view m) { return isOneOf(m, "123"); })) {
+                return false;
+            }
+            for (size_t i = 2; i < 14; i++) {
+                if (!isOptionalDigits(v[i])) return false;
+            }
+            return optional(v[14], isDecimal) && optional(v[15], isDecimal) && optional(v[16], isDecimal) &&
+                   (f.Count == 17 || isOptionalDigits(v[17]));
+        }
+
+        bool validVTG(const SentenceFields &f) {
+            auto &v = f.Values;
+            return f.Formatter == "VTG" && f.Count == 9 &&
+                   optional(v[0], isDecimal) && (v[1].empty() || v[1] == "T") &&
+                   optional(v[2], isDecimal) && (v[3].empty() || v[3] == "M") &&
+                   optional(v[4], isDecimal) && (v[5].empty() || v[5] == "N") &&
+                   optional(v[6], isDecimal) && (v[7].empty() || v[7] == "K") &&
+                   optional(v[8], [](std::string_view m) { return isOneOf(m, "NEAD"); });
+        }
+
+        bool validGLL(const SentenceFields &f) {
+            auto &v = f.Values;
+            return f.Formatter == "GLL" && f.Count == 7 &&
+                   optional(v[0], isDecimal) && optional(v[1], [](std::string_view i) { return isOneOf(i, "NS"); }) &&
+                   optional(v[2], isDecimal) && optional(v[3], [](std::string_view i) { return isOneOf(i, "EW"); }) &&
+                   optional(v[4], isTime) &&
+                   optional(v[5], [](std::string_view s) { return isOneOf(s, "AV"); }) &&
+                   optional(v[6], [](std::string_view m) { return isOneOf(m, "NEAD"); });
+        }
+
+        bool validTXT(const SentenceFields &f) {
+            auto &v = f.Values;
+            auto twoDigits = [](std::string_view n) { return isNDigits(n, 2); };
+            return f.Formatter == "TXT" && f.Count >= 4 &&
+                   optional(v[0], twoDigits) && optional(v[1], twoDigits) && optional(v[2], twoDigits);
+        }
+
+        bool validRMC(const SentenceFields &f) {
+            auto &v = f.Values;
+            // the navigational status is only present from NMEA 4.1
+            return f.Formatter == "RMC" && (f.Count == 12 || f.Count == 13) &&
+                   optional(v[0], isTime) && isOneOf(v[1], "VA") &&
+                   optional(v[2], isDecimal) && optional(v[3], [](std::string_view i) { return isOneOf(i, "NS"); }) &&
+                   optional(v[4], isDecimal) && optional(v[5], [](std::string_view i) { return isOneOf(i, "EW"); }) &&
+                   optional(v[6], isDecimal) && optional(v[7], isDecimal) &&
+                   optional(v[8], [](std::string_view d) { return isNDigits(d, 6); }) &&
+                   optional(v[9], isDecimal) && optional(v[10], [](std::string_view i) { return isOneOf(i, "EW"); }) &&
+                   optional(v[11], [](std::string_view m) { return isOneOf(m, "NEAD"); }) &&
+                   (f.Count == 12 || optional(v[12], [](std::string_view s) { return isOneOf(s, "AV"); }));
+        }
+
+        /**
+         * tokenizeAndValidate tokenizes a sentence and checks its fields with the given validator.
+         */
+        template<typename V>
+        ParseStatus tokenizeAndValidate(std::string_view sentence, SentenceFields &f, V valid) {
+            auto status = Tokenize(sentence, f);
+            if (status != PARSE_OK) {
+                return status;
+            }
+            return valid(f) ? PARSE_OK : PARSE_INVALID_SENTENCE;
+        }
+
+        /**
+         * materialize parses a sentence into a view and copies it into the owning type, so that both validate
+         * identically.
+         */
+        template<typename View, typename Owning>
+        ParseStatus materialize(ParseStatus (*parse)(std::string_view, View &), std::string_view s, Owning &out) {
+            View v;
+            auto status = parse(s, v);
+            if (status == PARSE_OK) {
+                out = Owning(v);
+            }
+            return status;
+        }
     }
 
-    void NeoM8N::RegisterCallback(const std::string &key, GPSCallback cb) {
-        cbs.insert_or_assign(key, cb);
+    uint8_t Checksum(std::string_view data) {
+        auto p = reinterpret_cast<const uint8_t *>(data.data());
+        auto n = data.size();
+        size_t i = 0;
+        uint8_t checksum = 0;
+#if defined(__SSE2__)
+        if (n >= 16) {
+            auto acc = _mm_setzero_si128();
+            for (; i + 16 <= n; i += 16) {
+                acc = _mm_xor_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+            }
+            // fold the 16 lanes into one
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+            acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+            checksum = static_cast<uint8_t>(_mm_cvtsi128_si32(acc));
+        }
+#elif defined(__ARM_NEON)
+        if (n >= 16) {
+            auto acc = vdupq_n_u8(0);
+            for (; i + 16 <= n; i += 16) {
+                acc = veorq_u8(acc, vld1q_u8(p + i));
+            }
+            // fold the 16 lanes into 8 and then into one
+            auto folded = vget_lane_u64(vreinterpret_u64_u8(veor_u8(vget_low_u8(acc), vget_high_u8(acc))), 0);
+            folded ^= folded >> 32;
+            folded ^= folded >> 16;
+            folded ^= folded >> 8;
+            checksum = static_cast<uint8_t>(folded);
+        }
+#endif
+        for (; i < n; i++) {
+            checksum ^= p[i];
+        }
+        return checksum;
     }
 
-    void NeoM8N::DeregisterCallback(const std::string &key) {
-        cbs.erase(key);
+    bool ValidChecksum(std::string_view sentence) {
+        auto s = trimSentence(sentence);
+        auto star = s.rfind('*');
+        uint8_t expected;
+        return star != std::string_view::npos && parseChecksum(s.substr(star + 1), expected) &&
+               Checksum(s.substr(1, star - 1)) == expected;
     }
 
-    void NeoM8N::Read() {
-        int res;
-        char buf[4096];
-        reading = true;
-        while (true) {
-            if (!reading) {
-                return;
-            }
-            memset(buf, 0, sizeof(buf));
-            res = read(fd, buf, 4096);
-            if (res == -1) {
-                if (errno == EAGAIN) {
-                    sleep(1);
-                    continue;
-                } else {
-                    clog << "ERROR: " << strerror(errno) << endl;
-                    return;
-                }
+    IncrementalParser::IncrementalParser(std::function<void(std::string_view)> onSentence,
+                                         std::function<void(const GGAFix &)> onGGA) :
+            onSentence(std::move(onSentence)), onGGA(std::move(onGGA)) {}
+
+    void IncrementalParser::Feed(const char *data, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            auto c = data[i];
+            if (c == '$') {
+                /* a start delimiter always starts a new sentence, dropping an incomplete one */
+                buffer[0] = c;
+                length = 1;
+                checksum = 0;
+                st = ADDRESS;
+                continue;
             }
-            if (res == 0) {
+            if (st == WAIT_START) {
                 continue;
             }
-            if (buf[0] != '$') {
+            if (length == buffer.size()) {
+                st = WAIT_START;
                 continue;
             }
-            /* set end of string, so we can printf */
-            buf[res] = 0;
-            // execute all callbacks
-            for (auto const &v : cbs) {
-                v.second(std::string(buf));
+            buffer[length++] = c;
+            switch (st) {
+                case ADDRESS:
+                    if (!isUpper(c)) {
+                        st = WAIT_START;
+                        break;
+                    }
+                    checksum ^= c;
+                    if (length == 6) {
+                        SentenceType t;
+                        isGGA = formatterToSentenceType(std::string_view(buffer.data() + 3, 3), t) && t == GGA_TYPE;
+                        validGGA = isGGA;
+                        fix = GGAFix();
+                        fieldIndex = 0;
+                        st = AFTER_ADDRESS;
+                    }
+                    break;
+                case AFTER_ADDRESS:
+                    if (c == ',') {
+                        checksum ^= c;
+                        fieldStart = length;
+                        st = FIELDS;
+                    } else if (c == '*') {
+                        expectedChecksum = 0;
+                        checksumDigits = 0;
+                        st = CHECKSUM;
+                    } else {
+                        st = WAIT_START;
+                    }
+                    break;
+                case FIELDS:
+                    if (c == '*') {
+                        endField();
+                        expectedChecksum = 0;
+                        checksumDigits = 0;
+                        st = CHECKSUM;
+                        break;
+                    }
+                    checksum ^= c;
+                    if (c == ',') {
+                        endField();
+                        fieldStart = length;
+                    }
+                    break;
+                case CHECKSUM:
+                    if (!isHex(c)) {
+                        st = WAIT_START;
+                        break;
+                    }
+                    expectedChecksum = expectedChecksum * 16 + (isDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+                    if (++checksumDigits == 2) {
+                        endSentence();
+                        st = WAIT_START;
+                    }
+                    break;
+                default:
+                    break;
             }
         }
     }
 
-    NeoM8N::~NeoM8N() {
-        /* stop capturing */
-        reading = false;
-        /* restore the old port settings */
-        tcsetattr(fd, TCSANOW, &oldPortSettings);
-        /* close the port */
-        close(fd);
-    }
-
-    std::string &ltrim(std::string &str, const std::string &chars = "\t\n\v\f\r ") {
-        str.erase(0, str.find_first_not_of(chars));
-        return str;
+    void IncrementalParser::endField() {
+        if (validGGA) {
+            /* the delimiter that ended the field is already in the buffer */
+            std::string_view field(buffer.data() + fieldStart, length - 1 - fieldStart);
+            validGGA = decodeGGAField(fix, fieldIndex, field);
+        }
+        fieldIndex++;
     }
 
-    std::string &rtrim(std::string &str, const std::string &chars = "\t\n\v\f\r ") {
-        str.erase(str.find_last_not_of(chars) + 1);
-        return str;
+    void IncrementalParser::endSentence() {
+        if (checksum != expectedChecksum) {
+            rejectedSentences++;
+            return;
+        }
+        if (onSentence) {
+            onSentence(std::string_view(buffer.data(), length));
+        }
+        if (validGGA && fieldIndex >= 13 && onGGA) {
+            fix.Talker = {buffer[1], buffer[2]};
+            onGGA(fix);
+        }
     }
 
-    std::string &trim(std::string &str, const std::string &chars = "\t\n\v\f\r ") {
-        return ltrim(rtrim(str, chars), chars);
+    uint64_t IncrementalParser::RejectedSentences() const {
+        return rejectedSentences;
     }
 
-    string getMatch(string m) {
-        if (string(m).empty()) throw InvalidSentenceError();
-        return m;
+    ParseStatus Tokenize(std::string_view sentence, SentenceFields &fields) {
+        return tokenize(sentence, fields.Talker, fields.Formatter, fields.Checksum, fields.Count,
+                        [&](size_t i, std::string_view field) {
+                            if (i == MAX_SENTENCE_FIELDS) return false;
+                            fields.Values[i] = field;
+                            return true;
+                        });
     }
 
     SatelliteInfo::SatelliteInfo(const string &s) {
-        std::regex r(GSV_SATELLITE_INFO_REGEX);
-        std::smatch sat_info_match;
-        if (std::regex_search(s, sat_info_match, r)) {
-            SatelliteID = getMatch(sat_info_match[1]);
-            Elevation = getMatch(sat_info_match[2]);
-            Azimuth = getMatch(sat_info_match[3]);
-            std::string(sat_info_match[4]).empty() ?
-                    SignalStrength = "" :
-                    SignalStrength = sat_info_match[4];
-        }
-    }
-
-    GSV::GSV(const string &sentence) {
-        std::regex r(GSV_REGEX);
-        std::smatch match;
-        auto s = sentence;
-        trim(s);
-        if (std::regex_search(s, match, r)) {
-            if (match.size() != 7) {
-                throw InvalidSentenceError();
+        // the satellite info is expected in the form ",<id>,<elevation>,<azimuth>,<signal strength>"
+        SentenceFields f;
+        auto start = s.find(',');
+        if (start == string::npos) throw InvalidSentenceError();
+        std::string_view v(s);
+        v = v.substr(start + 1, v.find_last_not_of(WHITESPACE) - start);
+        for (f.Count = 0; f.Count < 4; f.Count++) {
+            auto comma = v.find(',');
+            f.Values[f.Count] = v.substr(0, comma);
+            if (comma == std::string_view::npos) {
+                f.Count++;
+                break;
             }
-            Type = GSV_TYPE;
-            Talker = getMatch(match[1]);
-            NumberOfMessages = getMatch(match[2]);
-            MessageNumber = getMatch(match[3]);
-            NumberOfSatellites = getMatch(match[4]);
-            auto all_sat_infos = getMatch(match[5]);
-            std::regex gsv_sat_info(",([0-9]+),([0-9]+),([0-9]+),([0-9]+)*");
-            std::smatch sub_match;
-            string::const_iterator searchStart(all_sat_infos.cbegin());
-            while (regex_search(searchStart, all_sat_infos.cend(), sub_match, gsv_sat_info)) {
-                searchStart = sub_match.suffix().first;
-                auto sat_info_str = std::string(sub_match[0]);
-                SatelliteInfos.emplace_back(sat_info_str);
-            }
-        }
-    }
-
-    GGA::GGA(const string &sentence) {
-        std::regex r(GGA_REGEX);
-        std::smatch match;
-        auto s = std::string(sentence);
-        trim(s);
-        if (std::regex_search(s, match, r)) {
-            if (match.size() != 14) {
-                throw InvalidSentenceError();
+            v = v.substr(comma + 1);
+        }
+        if (f.Count != 4 || !validSatelliteInfo(f, 0)) {
+            throw InvalidSentenceError();
+        }
+        SatelliteID = string(f.Values[0]);
+        Elevation = string(orZero(f.Values[1]));
+        Azimuth = string(orZero(f.Values[2]));
+        SignalStrength = string(f.Values[3]);
+    }
+
+    SatelliteInfo::SatelliteInfo(const SatelliteInfoView &v) :
+            SatelliteID(v.SatelliteID), Elevation(v.Elevation), Azimuth(v.Azimuth),
+            SignalStrength(v.SignalStrength) {}
+
+    SatelliteInfo SatelliteInfoView::Materialize() const {
+        return SatelliteInfo(*this);
+    }
+
+    ParseStatus TryParseGSV(std::string_view sentence, GSVView &gsv) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validGSV);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        gsv.Type = GSV_TYPE;
+        gsv.Talker = f.Talker;
+        gsv.NumberOfMessages = v[0];
+        gsv.MessageNumber = v[1];
+        gsv.NumberOfSatellites = v[2];
+        gsv.SatelliteInfoCount = (f.Count - 3) / 4;
+        for (size_t i = 0; i < gsv.SatelliteInfoCount; i++) {
+            auto &info = gsv.SatelliteInfos[i];
+            info.SatelliteID = v[3 + i * 4];
+            info.Elevation = orZero(v[4 + i * 4]);
+            info.Azimuth = orZero(v[5 + i * 4]);
+            info.SignalStrength = v[6 + i * 4];
+        }
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseGSV(std::string_view sentence, GSV &gsv) {
+        return materialize<GSVView>(TryParseGSV, sentence, gsv);
+    }
+
+    GSVView::GSVView(std::string_view sentence) {
+        if (TryParseGSV(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    GSV GSVView::Materialize() const {
+        return GSV(*this);
+    }
+
+    GSV::GSV(const string &sentence) : GSV(GSVView(sentence)) {}
+
+    GSV::GSV(const GSVView &v) :
+            Type(GSV_TYPE), Talker(v.Talker), NumberOfMessages(v.NumberOfMessages), MessageNumber(v.MessageNumber),
+            NumberOfSatellites(v.NumberOfSatellites) {
+        SatelliteInfos.reserve(v.SatelliteInfoCount);
+        for (size_t i = 0; i < v.SatelliteInfoCount; i++) {
+            SatelliteInfos.emplace_back(v.SatelliteInfos[i]);
+        }
+    }
+
+    ParseStatus TryParseGGA(std::string_view sentence, GGAView &gga) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validGGA);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        gga.Type = GGA_TYPE;
+        gga.Talker = f.Talker;
+        gga.Time = v[0];
+        gga.Latitude = v[1];
+        gga.NorthSouthIndicator = v[2];
+        gga.Longitude = v[3];
+        gga.EastWestIndicator = v[4];
+        gga.QualityIndicator = v[5];
+        gga.NumberOfSatellitesUsed = v[6];
+        gga.HDOP = v[7];
+        gga.Altitude = v[8];
+        gga.GeoIDSeparation = v[10];
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseGGA(std::string_view sentence, GGA &gga) {
+        return materialize<GGAView>(TryParseGGA, sentence, gga);
+    }
+
+    ParseStatus TryParseGGA(std::string_view sentence, GGAFix &gga) {
+        std::string_view talker, formatter, checksum;
+        size_t count;
+        auto status = tokenize(sentence, talker, formatter, checksum, count, [&](size_t i, std::string_view f) {
+            return formatter == "GGA" && decodeGGAField(gga, i, f);
+        });
+        if (status != PARSE_OK) {
+            return status;
+        }
+        if (count < 13) {
+            return PARSE_INVALID_SENTENCE;
+        }
+        gga.Type = GGA_TYPE;
+        gga.Talker = {talker[0], talker[1]};
+        return PARSE_OK;
+    }
+
+    GGAView::GGAView(std::string_view sentence) {
+        if (TryParseGGA(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    GGA GGAView::Materialize() const {
+        return GGA(*this);
+    }
+
+    GGAFix::GGAFix(std::string_view sentence) {
+        if (TryParseGGA(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    GGA::GGA(const string &sentence) : GGA(GGAView(sentence)) {}
+
+    GGA::GGA(const GGAView &v) :
+            Type(GGA_TYPE), Talker(v.Talker), Time(v.Time), Latitude(v.Latitude),
+            NorthSouthIndicator(v.NorthSouthIndicator), Longitude(v.Longitude),
+            EastWestIndicator(v.EastWestIndicator), QualityIndicator(v.QualityIndicator),
+            NumberOfSatellitesUsed(v.NumberOfSatellitesUsed), HDOP(v.HDOP), Altitude(v.Altitude),
+            GeoIDSeparation(v.GeoIDSeparation) {}
+
+    ParseStatus TryParseZDA(std::string_view sentence, ZDAView &zda) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validZDA);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        zda.Type = ZDA_TYPE;
+        zda.Talker = f.Talker;
+        zda.Time = v[0];
+        zda.Day = v[1];
+        zda.Month = v[2];
+        zda.Year = v[3];
+        zda.LocalZoneHours = v[4];
+        zda.LocalZoneMinutes = v[5];
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseZDA(std::string_view sentence, ZDA &zda) {
+        return materialize<ZDAView>(TryParseZDA, sentence, zda);
+    }
+
+    ZDAView::ZDAView(std::string_view sentence) {
+        if (TryParseZDA(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    ZDA ZDAView::Materialize() const {
+        return ZDA(*this);
+    }
+
+    ZDA::ZDA(const string &sentence) : ZDA(ZDAView(sentence)) {}
+
+    ZDA::ZDA(const ZDAView &v) :
+            Type(ZDA_TYPE), Talker(v.Talker), Time(v.Time), Day(v.Day), Month(v.Month), Year(v.Year),
+            LocalZoneHours(v.LocalZoneHours), LocalZoneMinutes(v.LocalZoneMinutes) {}
+
+    ParseStatus TryParseGSA(std::string_view sentence, GSAView &gsa) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validGSA);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        gsa.Type = GSA_TYPE;
+        gsa.Talker = f.Talker;
+        gsa.OperationMode = v[0];
+        gsa.NavigationMode = v[1];
+        gsa.SatelliteIDCount = 0;
+        for (size_t i = 2; i < 14; i++) {
+            if (!v[i].empty()) {
+                gsa.SatelliteIDs[gsa.SatelliteIDCount++] = v[i];
             }
-            Type = GGA_TYPE;
-            Talker = getMatch(match[1]);
-            Time = getMatch(match[2]);
-            Latitude =getMatch(match[3]);
-            NorthSouthIndicator = getMatch(match[4]);
-            Longitude = getMatch(match[5]);
-            EastWestIndicator = getMatch(match[6]);
-            QualityIndicator = getMatch(match[7]);
-            NumberOfSatellitesUsed = getMatch(match[8]);
-            HDOP = getMatch(match[9]);
-            Altitude = getMatch(match[10]);
-            GeoIDSeparation = getMatch(match[11]);
+        }
+        gsa.PDOP = v[14];
+        gsa.HDOP = v[15];
+        gsa.VDOP = v[16];
+        gsa.SystemID = f.Count == 18 ? v[17] : std::string_view();
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseGSA(std::string_view sentence, GSA &gsa) {
+        return materialize<GSAView>(TryParseGSA, sentence, gsa);
+    }
+
+    GSAView::GSAView(std::string_view sentence) {
+        if (TryParseGSA(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
         }
     }
 
+    GSA GSAView::Materialize() const {
+        return GSA(*this);
+    }
+
+    GSA::GSA(const string &sentence) : GSA(GSAView(sentence)) {}
+
+    GSA::GSA(const GSAView &v) :
+            Type(GSA_TYPE), Talker(v.Talker), OperationMode(v.OperationMode), NavigationMode(v.NavigationMode),
+            SatelliteIDs(v.SatelliteIDs.begin(), v.SatelliteIDs.begin() + v.SatelliteIDCount), PDOP(v.PDOP),
+            HDOP(v.HDOP), VDOP(v.VDOP), SystemID(v.SystemID) {}
+
+    ParseStatus TryParseVTG(std::string_view sentence, VTGView &vtg) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validVTG);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        vtg.Type = VTG_TYPE;
+        vtg.Talker = f.Talker;
+        vtg.CourseOverGroundTrue = v[0];
+        vtg.CourseOverGroundMagnetic = v[2];
+        vtg.SpeedOverGroundKnots = v[4];
+        vtg.SpeedOverGroundKmh = v[6];
+        vtg.ModeIndicator = v[8];
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseVTG(std::string_view sentence, VTG &vtg) {
+        return materialize<VTGView>(TryParseVTG, sentence, vtg);
+    }
+
+    VTGView::VTGView(std::string_view sentence) {
+        if (TryParseVTG(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    VTG VTGView::Materialize() const {
+        return VTG(*this);
+    }
+
+    VTG::VTG(const string &sentence) : VTG(VTGView(sentence)) {}
+
+    VTG::VTG(const VTGView &v) :
+            Type(VTG_TYPE), Talker(v.Talker), CourseOverGroundTrue(v.CourseOverGroundTrue),
+            CourseOverGroundMagnetic(v.CourseOverGroundMagnetic), SpeedOverGroundKnots(v.SpeedOverGroundKnots),
+            SpeedOverGroundKmh(v.SpeedOverGroundKmh), ModeIndicator(v.ModeIndicator) {}
+
+    ParseStatus TryParseGLL(std::string_view sentence, GLLView &gll) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validGLL);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        gll.Type = GLL_TYPE;
+        gll.Talker = f.Talker;
+        gll.Latitude = v[0];
+        gll.NorthSouthIndicator = v[1];
+        gll.Longitude = v[2];
+        gll.EastWestIndicator = v[3];
+        gll.Time = v[4];
+        gll.Status = v[5];
+        gll.ModeIndicator = v[6];
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseGLL(std::string_view sentence, GLL &gll) {
+        return materialize<GLLView>(TryParseGLL, sentence, gll);
+    }
+
+    GLLView::GLLView(std::string_view sentence) {
+        if (TryParseGLL(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    GLL GLLView::Materialize() const {
+        return GLL(*this);
+    }
+
+    GLL::GLL(const string &sentence) : GLL(GLLView(sentence)) {}
+
+    GLL::GLL(const GLLView &v) :
+            Type(GLL_TYPE), Talker(v.Talker), Latitude(v.Latitude), NorthSouthIndicator(v.NorthSouthIndicator),
+            Longitude(v.Longitude), EastWestIndicator(v.EastWestIndicator), Time(v.Time), Status(v.Status),
+            ModeIndicator(v.ModeIndicator) {}
+
+    ParseStatus TryParseTXT(std::string_view sentence, TXTView &txt) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validTXT);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        txt.Type = TXT_TYPE;
+        txt.Talker = f.Talker;
+        txt.NumberOfMessages = v[0];
+        txt.MessageNumber = v[1];
+        txt.TextIdentifier = v[2];
+        // the text may itself contain commas, so it spans all remaining fields
+        auto &last = v[f.Count - 1];
+        txt.Text = std::string_view(v[3].data(), last.data() + last.size() - v[3].data());
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseTXT(std::string_view sentence, TXT &txt) {
+        return materialize<TXTView>(TryParseTXT, sentence, txt);
+    }
+
+    TXTView::TXTView(std::string_view sentence) {
+        if (TryParseTXT(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    TXT TXTView::Materialize() const {
+        return TXT(*this);
+    }
+
+    TXT::TXT(const string &sentence) : TXT(TXTView(sentence)) {}
+
+    TXT::TXT(const TXTView &v) :
+            Type(TXT_TYPE), Talker(v.Talker), NumberOfMessages(v.NumberOfMessages), MessageNumber(v.MessageNumber),
+            TextIdentifier(v.TextIdentifier), Text(v.Text) {}
+
+    ParseStatus TryParseRMC(std::string_view sentence, RMCView &rmc) {
+        SentenceFields f;
+        auto status = tokenizeAndValidate(sentence, f, validRMC);
+        if (status != PARSE_OK) {
+            return status;
+        }
+        auto &v = f.Values;
+        rmc.Type = RMC_TYPE;
+        rmc.Talker = f.Talker;
+        rmc.Time = v[0];
+        rmc.Status = v[1];
+        rmc.Latitude = v[2];
+        rmc.NorthSouthIndicator = v[3];
+        rmc.Longitude = v[4];
+        rmc.EastWestIndicator = v[5];
+        rmc.SpeedOverGround = v[6];
+        rmc.CourseOverGround = v[7];
+        rmc.Date = v[8];
+        rmc.MagneticVariation = v[9];
+        rmc.MagneticVariationEastWestIndicator = v[10];
+        rmc.ModeIndicator = v[11];
+        rmc.NavigationStatus = f.Count == 13 ? v[12] : std::string_view();
+        return PARSE_OK;
+    }
+
+    ParseStatus TryParseRMC(std::string_view sentence, RMC &rmc) {
+        return materialize<RMCView>(TryParseRMC, sentence, rmc);
+    }
+
+    RMCView::RMCView(std::string_view sentence) {
+        if (TryParseRMC(sentence, *this) != PARSE_OK) {
+            throw InvalidSentenceError();
+        }
+    }
+
+    RMC RMCView::Materialize() const {
+        return RMC(*this);
+    }
+
+    RMC::RMC(const string &sentence) : RMC(RMCView(sentence)) {}
+
+    RMC::RMC(const RMCView &v) :
+            Type(RMC_TYPE), Talker(v.Talker), Time(v.Time), Status(v.Status), Latitude(v.Latitude),
+            NorthSouthIndicator(v.NorthSouthIndicator), Longitude(v.Longitude),
+            EastWestIndicator(v.EastWestIndicator), SpeedOverGround(v.SpeedOverGround),
+            CourseOverGround(v.CourseOverGround), Date(v.Date), MagneticVariation(v.MagneticVariation),
+            MagneticVariationEastWestIndicator(v.MagneticVariationEastWestIndicator),
+            ModeIndicator(v.ModeIndicator), NavigationStatus(v.NavigationStatus) {}
+
     const char *InvalidSentenceError::what() const noexcept {
         return "the provided sentence has an invalid format for the specified type";
     }
@@ -223,6 +2620,16 @@ namespace neom8n {
         return "no matching sentence type for the string provided";
     }
 
+    DeviceError::DeviceError(std::string message) : message(std::move(message)) {}
+
+    const char *DeviceError::what() const noexcept {
+        return message.c_str();
+    }
+
+    const char *UnsupportedBaudRateError::what() const noexcept {
+        return "unsupported baud rate - must be one of: 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600";
+    }
+
     string SentenceTypeToString(SentenceType t) {
         switch (t) {
             case GGA_TYPE:
@@ -252,36 +2659,33 @@ namespace neom8n {
      * @return the enumerated type represented by the string
      */
     SentenceType StringToSentenceType(const string &s) {
-        if (s == "GGA") {
-            return GGA_TYPE;
-        } else if (s == "VTG") {
-            return VTG_TYPE;
-        } else if (s == "GSV") {
-            return GSV_TYPE;
-        } else if (s == "GLL") {
-            return GLL_TYPE;
-        } else if (s == "ZDA") {
-            return ZDA_TYPE;
-        } else if (s == "TXT") {
-            return TXT_TYPE;
-        } else if (s == "RMC") {
-            return RMC_TYPE;
-        } else if (s == "GSA") {
-            return GSA_TYPE;
-        }
-        throw NoMatchingSentenceTypeError();
+        SentenceType t;
+        if (!formatterToSentenceType(s, t)) {
+            throw NoMatchingSentenceTypeError();
+        }
+        return t;
+    }
+
+    ParseStatus TryGetSentenceType(std::string_view sentence, SentenceType &t) {
+        auto formatter = sentenceFormatter(sentence);
+        if (formatter.empty()) {
+            return PARSE_INVALID_SENTENCE;
+        }
+        if (!formatterToSentenceType(formatter, t)) {
+            return PARSE_NO_MATCHING_TYPE;
+        }
+        return PARSE_OK;
     }
 
     SentenceType GetSentenceType(const string &sentence) {
-        std::regex r(TYPE_REGEX);
-        std::smatch match;
-        auto s = sentence;
-        trim(s);
-        if (std::regex_search(s, match, r)) {
-            if (match.size() != 2) {
+        SentenceType t;
+        switch (TryGetSentenceType(sentence, t)) {
+            case PARSE_OK:
+                return t;
+            case PARSE_NO_MATCHING_TYPE:
+                throw NoMatchingSentenceTypeError();
+            default:
                 throw InvalidSentenceError();
-            }
         }
-        return StringToSentenceType(getMatch(match[1]));
     }
 }
@@ -2,8 +2,22 @@
 #define NEOM8N_NEOM8N_H
 
 #include <string>
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <list>
 #include <map>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <mutex>
+#include <thread>
 #include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -11,8 +25,9 @@
 #include <iostream>
 #include <termios.h>
 #include <cstdio>
+#include <cstring>
 #include <unistd.h>
-#include <regex>
+#include <poll.h>
 
 using std::string;
 
@@ -20,19 +35,8 @@ namespace neom8n {
 
     typedef std::function<void(string data)> GPSCallback;
 
-    // todo support checksum validation
-//    #define CHECKSUM_REGEX "[$](.*)[*]([0-9A-Fa-f]+)$"
-#define TYPE_REGEX "[$][A-Z]{2}([A-Z]{3}).*[*][0-9A-Fa-f]+$"
-#define GGA_REGEX "[$]([A-Z]{2})GGA,([0-9]{2}[0-9]{2}[0-9]{2}[.][0-9]+)*,([0-9]+[.][0-9]+)*,([NS])*,([0-9]+[.][0-9]+)*,([EW])*,([0126])*,([0-9]{2}),([0-9]+[.][0-9]+)*,([0-9]+[.][0-9]+)*,M*,([0-9]+[.][0-9]+)*,(.*),(.*)[*][0-9A-Fa-f]+$"
-#define GSV_REGEX "[$]([A-Z]{2})GSV,([0-9]+)*,([0-9]+)*,([0-9]+)*((?:,[0-9]+,[0-9]*,[0-9]*,[0-9]*){0,4})(?:,([0-9]*))*[*][0-9A-Fa-f]+$"
-#define GSV_SATELLITE_INFO_REGEX ",([0-9]+)+,([0-9]+)+,([0-9]+)+,([0-9]+)*"
-#define ZDA_REGEX "[$]([A-Z]{2})ZDA,([0-9]{2}[0-9]{2}[0-9]{2}[.][0-9]+)*,([0-9]{2})*,([0-9]{2})*,([0-9]{4})*,([-]*[0-9]{2})*,([0-9]{2})*[*][0-9A-Fa-f]+$"
-#define GSA_REGEX "[$]([A-Z]{2})GSA,([MA])*,([123])*((?:,[0-9]*){0,12}),([0-9]+[.][0-9]+)*,([0-9]+[.][0-9]+)*,([0-9]+[.][0-9]+)*(?:,([0-9]+))*[*][0-9A-Fa-f]+$"
-#define GSA_SATELLITE_IDS_REGEX ",([0-9]+)*"
-#define VTG_REGEX "[$]([A-Z]{2})VTG,([0-9]+[.][0-9]+)*,T*,(.*),M*,([0-9]+[.][0-9]+)*,N*,([0-9]+[.][0-9]+)*,K*,([NEAD])*[*][0-9A-Fa-f]+$"
-#define GLL_REGEX "[$]([A-Z]{2})GLL,([0-9]+[.][0-9]+)*,([NS])*,([0-9]+[.][0-9]+)*,([EW])*,([0-9]{2}[0-9]{2}[0-9]{2}[.][0-9]+)*,([AV])*,([NEAD])*[*][0-9A-Fa-f]+$"
-#define TXT_REGEX "[$]([A-Z]{2})TXT,([0-9][0-9])*,([0-9][0-9])*,([0-9][0-9])*,(.*)[*][0-9A-Fa-f]+$"
-#define RMC_REGEX "[$]([A-Z]{2})RMC,([0-9]{2}[0-9]{2}[0-9]{2}[.][0-9]+)*,([VA]),([0-9]+[.][0-9]+)*,([NS])*,([0-9]+[.][0-9]+)*,([EW])*,([0-9]+[.][0-9]+)*,([0-9]+[.][0-9]+)*,([0-9]{2}[0-9]{2}[0-9]{2})*,,,([NEAD])*(?:,([AV]))*[*][0-9A-Fa-f]+$"
+    // SentenceCallback receives a view over the receive buffer, which is only valid for the duration of the call
+    typedef std::function<void(std::string_view sentence)> SentenceCallback;
 
     class InvalidSentenceTypeError : public std::exception {
         virtual const char *what() const noexcept override;
@@ -42,6 +46,21 @@ namespace neom8n {
         virtual const char *what() const noexcept override;
     };
 
+    // the maximum number of comma-separated fields in a supported sentence (GSV with 4 satellites and a signal ID has 20)
+    constexpr size_t MAX_SENTENCE_FIELDS = 24;
+
+    /**
+     * ParseStatus is the outcome of the non-throwing Try* parse functions. The throwing parsers report
+     * PARSE_NO_MATCHING_TYPE as NoMatchingSentenceTypeError and every other failure (including a checksum mismatch)
+     * as InvalidSentenceError.
+     */
+    enum ParseStatus {
+        PARSE_OK = 0,
+        PARSE_INVALID_SENTENCE,
+        PARSE_NO_MATCHING_TYPE,
+        PARSE_CHECKSUM_MISMATCH
+    };
+
     enum SentenceType {
         GGA_TYPE = 0,
         VTG_TYPE,
@@ -53,6 +72,22 @@ namespace neom8n {
         GSA_TYPE
     };
 
+    constexpr size_t SENTENCE_TYPE_COUNT = GSA_TYPE + 1;
+
+    /**
+     * FormatterCode packs a three character sentence formatter (e.g. "GGA") into a 24-bit integer, which is what the
+     * sentence type lookup is keyed on.
+     */
+    constexpr uint32_t FormatterCode(char a, char b, char c) {
+        return static_cast<uint32_t>(static_cast<uint8_t>(a)) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8 |
+               static_cast<uint32_t>(static_cast<uint8_t>(c));
+    }
+
+    constexpr uint32_t FormatterCode(const char (&formatter)[4]) {
+        return FormatterCode(formatter[0], formatter[1], formatter[2]);
+    }
+
     string SentenceTypeToString(SentenceType t);
 
     SentenceType StringToSentenceType(const string &s);
@@ -63,11 +98,133 @@ namespace neom8n {
         virtual const char *what() const noexcept override;
     };
 
+    /**
+     * SentenceFields is a tokenized NMEA sentence. All members are views into the sentence that was tokenized,
+     * so the sentence must outlive the fields.
+     */
+    class SentenceFields {
+    public:
+        std::string_view Talker;
+        std::string_view Formatter;
+        std::array<std::string_view, MAX_SENTENCE_FIELDS> Values;
+        size_t Count = 0;
+        std::string_view Checksum;
+    };
+
+    /**
+     * Tokenize splits a sentence of the form "$TTFFF,f1,f2,...*hh" into its fields in a single pass, without
+     * allocating, and verifies the checksum. Leading and trailing whitespace (e.g. a line ending) is ignored.
+     * @param sentence the sentence to tokenize
+     * @param fields receives the views into the sentence
+     * @return PARSE_INVALID_SENTENCE if the sentence is not a well-formed NMEA sentence, PARSE_CHECKSUM_MISMATCH if
+     * it is corrupted
+     */
+    ParseStatus Tokenize(std::string_view sentence, SentenceFields &fields);
+
+    /**
+     * Checksum calculates the NMEA checksum, i.e. the XOR of all bytes, of the data between '$' and '*'. The bytes
+     * are combined 16 at a time with SSE2 or NEON where available.
+     */
+    uint8_t Checksum(std::string_view data);
+
+    /**
+     * ValidChecksum verifies that the "*hh" suffix of a sentence matches the checksum of its contents, without
+     * validating the fields.
+     */
+    bool ValidChecksum(std::string_view sentence);
+
+    class GGA;
+    class SatelliteInfo;
+    class GSV;
+
+    /**
+     * GGAView is a GGA sentence whose fields are views into the parsed sentence, so parsing it does not allocate.
+     * The sentence must outlive the view; use Materialize to obtain an owning copy.
+     */
+    class GGAView {
+    public:
+        GGAView() = default;
+
+        explicit GGAView(std::string_view s);
+
+        GGA Materialize() const;
+
+        SentenceType Type = GGA_TYPE;
+        std::string_view Talker;
+        std::string_view Time;
+        std::string_view Latitude;
+        std::string_view NorthSouthIndicator;
+        std::string_view Longitude;
+        std::string_view EastWestIndicator;
+        std::string_view QualityIndicator;
+        std::string_view NumberOfSatellitesUsed;
+        std::string_view HDOP;
+        std::string_view Altitude;
+        std::string_view GeoIDSeparation;
+    };
+
+    class SatelliteInfoView {
+    public:
+        SatelliteInfo Materialize() const;
+
+        std::string_view SatelliteID;
+        std::string_view Elevation; // 0-90 degrees, 0 if not known
+        std::string_view Azimuth; // 0-359 degrees, 0 if not known
+        std::string_view SignalStrength; // 0-99 dBH
+    };
+
+    /**
+     * GSVView is a GSV sentence whose fields are views into the parsed sentence. The (at most four) satellite infos
+     * are stored inline, so parsing it does not allocate.
+     */
+    class GSVView {
+    public:
+        GSVView() = default;
+
+        explicit GSVView(std::string_view s);
+
+        GSV Materialize() const;
+
+        SentenceType Type = GSV_TYPE;
+        std::string_view Talker;
+        std::string_view NumberOfMessages;
+        std::string_view MessageNumber;
+        std::string_view NumberOfSatellites;
+        std::array<SatelliteInfoView, 4> SatelliteInfos;
+        size_t SatelliteInfoCount = 0;
+    };
+
+    /**
+     * GGAFix is a GGA sentence decoded into numeric values. The coordinates are signed decimal degrees (negative
+     * south and west) and the time is the number of milliseconds since midnight UTC.
+     */
+    class GGAFix {
+    public:
+        GGAFix() = default;
+
+        explicit GGAFix(std::string_view s);
+
+        SentenceType Type = GGA_TYPE;
+        std::array<char, 2> Talker{};
+        uint32_t TimeOfDay = 0;
+        double Latitude = 0;
+        double Longitude = 0;
+        int QualityIndicator = 0;
+        int NumberOfSatellitesUsed = 0;
+        float HDOP = 0;
+        float Altitude = 0; // meters above mean sea level
+        float GeoIDSeparation = 0; // meters
+    };
+
     class GGA {
     public:
+        GGA() = default;
+
         GGA(const string &s);
 
-        SentenceType Type;
+        explicit GGA(const GGAView &v);
+
+        SentenceType Type = GGA_TYPE;
         string Talker;
         string Time;
         string Latitude;
@@ -85,17 +242,23 @@ namespace neom8n {
     public:
         SatelliteInfo(const string &s);
 
+        explicit SatelliteInfo(const SatelliteInfoView &v);
+
         string SatelliteID;
-        string Elevation; // 0-90 degrees
-        string Azimuth; // 0-359 degrees
+        string Elevation; // 0-90 degrees, 0 if not known
+        string Azimuth; // 0-359 degrees, 0 if not known
         string SignalStrength; // 0-99 dBH
     };
 
     class GSV {
     public:
+        GSV() = default;
+
         GSV(const string &s);
 
-        SentenceType Type;
+        explicit GSV(const GSVView &v);
+
+        SentenceType Type = GSV_TYPE;
         string Talker;
         string NumberOfMessages;
         string MessageNumber;
@@ -103,24 +266,1552 @@ namespace neom8n {
         std::vector<SatelliteInfo> SatelliteInfos;
     };
 
+    class ZDA;
+    class GSA;
+    class VTG;
+    class GLL;
+    class TXT;
+    class RMC;
+
+    /**
+     * ZDAView is a ZDA (time and date) sentence whose fields are views into the parsed sentence.
+     */
+    class ZDAView {
+    public:
+        ZDAView() = default;
+
+        explicit ZDAView(std::string_view s);
+
+        ZDA Materialize() const;
+
+        SentenceType Type = ZDA_TYPE;
+        std::string_view Talker;
+        std::string_view Time;
+        std::string_view Day;
+        std::string_view Month;
+        std::string_view Year;
+        std::string_view LocalZoneHours;
+        std::string_view LocalZoneMinutes;
+    };
+
+    /**
+     * GSAView is a GSA (DOP and active satellites) sentence whose fields are views into the parsed sentence. Only the
+     * non-empty satellite ID fields are kept, inline.
+     */
+    class GSAView {
+    public:
+        GSAView() = default;
+
+        explicit GSAView(std::string_view s);
+
+        GSA Materialize() const;
+
+        SentenceType Type = GSA_TYPE;
+        std::string_view Talker;
+        std::string_view OperationMode; // M(anual) or A(utomatic)
+        std::string_view NavigationMode; // 1 (no fix), 2 (2D) or 3 (3D)
+        std::array<std::string_view, 12> SatelliteIDs;
+        size_t SatelliteIDCount = 0;
+        std::string_view PDOP;
+        std::string_view HDOP;
+        std::string_view VDOP;
+        std::string_view SystemID;
+    };
+
+    /**
+     * VTGView is a VTG (course over ground and ground speed) sentence whose fields are views into the parsed sentence.
+     */
+    class VTGView {
+    public:
+        VTGView() = default;
+
+        explicit VTGView(std::string_view s);
+
+        VTG Materialize() const;
+
+        SentenceType Type = VTG_TYPE;
+        std::string_view Talker;
+        std::string_view CourseOverGroundTrue; // degrees
+        std::string_view CourseOverGroundMagnetic; // degrees
+        std::string_view SpeedOverGroundKnots;
+        std::string_view SpeedOverGroundKmh;
+        std::string_view ModeIndicator;
+    };
+
+    /**
+     * GLLView is a GLL (latitude and longitude) sentence whose fields are views into the parsed sentence.
+     */
+    class GLLView {
+    public:
+        GLLView() = default;
+
+        explicit GLLView(std::string_view s);
+
+        GLL Materialize() const;
+
+        SentenceType Type = GLL_TYPE;
+        std::string_view Talker;
+        std::string_view Latitude;
+        std::string_view NorthSouthIndicator;
+        std::string_view Longitude;
+        std::string_view EastWestIndicator;
+        std::string_view Time;
+        std::string_view Status; // A(ctive) or V(oid)
+        std::string_view ModeIndicator;
+    };
+
+    /**
+     * TXTView is a TXT (text transmission) sentence whose fields are views into the parsed sentence.
+     */
+    class TXTView {
+    public:
+        TXTView() = default;
+
+        explicit TXTView(std::string_view s);
+
+        TXT Materialize() const;
+
+        SentenceType Type = TXT_TYPE;
+        std::string_view Talker;
+        std::string_view NumberOfMessages;
+        std::string_view MessageNumber;
+        std::string_view TextIdentifier; // 00 error, 01 warning, 02 notice, 07 user
+        std::string_view Text;
+    };
+
+    /**
+     * RMCView is an RMC (recommended minimum data) sentence whose fields are views into the parsed sentence.
+     */
+    class RMCView {
+    public:
+        RMCView() = default;
+
+        explicit RMCView(std::string_view s);
+
+        RMC Materialize() const;
+
+        SentenceType Type = RMC_TYPE;
+        std::string_view Talker;
+        std::string_view Time;
+        std::string_view Status; // A(ctive) or V(oid)
+        std::string_view Latitude;
+        std::string_view NorthSouthIndicator;
+        std::string_view Longitude;
+        std::string_view EastWestIndicator;
+        std::string_view SpeedOverGround; // knots
+        std::string_view CourseOverGround; // degrees
+        std::string_view Date; // ddmmyy
+        std::string_view MagneticVariation;
+        std::string_view MagneticVariationEastWestIndicator;
+        std::string_view ModeIndicator;
+        std::string_view NavigationStatus;
+    };
+
+    class ZDA {
+    public:
+        ZDA() = default;
+
+        ZDA(const string &s);
+
+        explicit ZDA(const ZDAView &v);
+
+        SentenceType Type = ZDA_TYPE;
+        string Talker;
+        string Time;
+        string Day;
+        string Month;
+        string Year;
+        string LocalZoneHours;
+        string LocalZoneMinutes;
+    };
+
+    class GSA {
+    public:
+        GSA() = default;
+
+        GSA(const string &s);
+
+        explicit GSA(const GSAView &v);
+
+        SentenceType Type = GSA_TYPE;
+        string Talker;
+        string OperationMode;
+        string NavigationMode;
+        std::vector<string> SatelliteIDs;
+        string PDOP;
+        string HDOP;
+        string VDOP;
+        string SystemID;
+    };
+
+    class VTG {
+    public:
+        VTG() = default;
+
+        VTG(const string &s);
+
+        explicit VTG(const VTGView &v);
+
+        SentenceType Type = VTG_TYPE;
+        string Talker;
+        string CourseOverGroundTrue;
+        string CourseOverGroundMagnetic;
+        string SpeedOverGroundKnots;
+        string SpeedOverGroundKmh;
+        string ModeIndicator;
+    };
+
+    class GLL {
+    public:
+        GLL() = default;
+
+        GLL(const string &s);
+
+        explicit GLL(const GLLView &v);
+
+        SentenceType Type = GLL_TYPE;
+        string Talker;
+        string Latitude;
+        string NorthSouthIndicator;
+        string Longitude;
+        string EastWestIndicator;
+        string Time;
+        string Status;
+        string ModeIndicator;
+    };
+
+    class TXT {
+    public:
+        TXT() = default;
+
+        TXT(const string &s);
+
+        explicit TXT(const TXTView &v);
+
+        SentenceType Type = TXT_TYPE;
+        string Talker;
+        string NumberOfMessages;
+        string MessageNumber;
+        string TextIdentifier;
+        string Text;
+    };
+
+    class RMC {
+    public:
+        RMC() = default;
+
+        RMC(const string &s);
+
+        explicit RMC(const RMCView &v);
+
+        SentenceType Type = RMC_TYPE;
+        string Talker;
+        string Time;
+        string Status;
+        string Latitude;
+        string NorthSouthIndicator;
+        string Longitude;
+        string EastWestIndicator;
+        string SpeedOverGround;
+        string CourseOverGround;
+        string Date;
+        string MagneticVariation;
+        string MagneticVariationEastWestIndicator;
+        string ModeIndicator;
+        string NavigationStatus;
+    };
+
+    /**
+     * TryGetSentenceType determines the type of a sentence without throwing. Like GetSentenceType it only inspects
+     * the address and the presence of a checksum, not its value.
+     * @param s the sentence
+     * @param t receives the type if PARSE_OK is returned
+     * @return PARSE_INVALID_SENTENCE for a malformed sentence, PARSE_NO_MATCHING_TYPE for an unsupported type
+     */
+    ParseStatus TryGetSentenceType(std::string_view s, SentenceType &t);
+
+    /**
+     * TryParseGGA parses a GGA sentence without throwing. The output is only complete if PARSE_OK is returned.
+     */
+    ParseStatus TryParseGGA(std::string_view s, GGAView &gga);
+
+    ParseStatus TryParseGGA(std::string_view s, GGAFix &gga);
+
+    ParseStatus TryParseGGA(std::string_view s, GGA &gga);
+
+    /**
+     * TryParseGSV parses a GSV sentence without throwing. The output is only complete if PARSE_OK is returned.
+     */
+    ParseStatus TryParseGSV(std::string_view s, GSVView &gsv);
+
+    ParseStatus TryParseGSV(std::string_view s, GSV &gsv);
+
+    /**
+     * TryParseZDA, TryParseGSA, TryParseVTG, TryParseGLL, TryParseTXT and TryParseRMC parse the respective sentence
+     * without throwing. Fields the receiver leaves empty (e.g. before it has a fix) are accepted as empty. The output
+     * is only complete if PARSE_OK is returned.
+     */
+    ParseStatus TryParseZDA(std::string_view s, ZDAView &zda);
+
+    ParseStatus TryParseZDA(std::string_view s, ZDA &zda);
+
+    ParseStatus TryParseGSA(std::string_view s, GSAView &gsa);
+
+    ParseStatus TryParseGSA(std::string_view s, GSA &gsa);
+
+    ParseStatus TryParseVTG(std::string_view s, VTGView &vtg);
+
+    ParseStatus TryParseVTG(std::string_view s, VTG &vtg);
+
+    ParseStatus TryParseGLL(std::string_view s, GLLView &gll);
+
+    ParseStatus TryParseGLL(std::string_view s, GLL &gll);
+
+    ParseStatus TryParseTXT(std::string_view s, TXTView &txt);
+
+    ParseStatus TryParseTXT(std::string_view s, TXT &txt);
+
+    ParseStatus TryParseRMC(std::string_view s, RMCView &rmc);
+
+    ParseStatus TryParseRMC(std::string_view s, RMC &rmc);
+
+    // the longest sentence, excluding the line ending, that is framed; NMEA allows 82 characters including it
+    constexpr size_t MAX_SENTENCE_LENGTH = 256;
+
+    // UBX sync characters, which start every frame
+    constexpr uint8_t UBX_SYNC_1 = 0xb5;
+    constexpr uint8_t UBX_SYNC_2 = 0x62;
+
+    // the sync characters, class, ID and length before the payload, and the checksum after it
+    constexpr size_t UBX_HEADER_LENGTH = 6;
+    constexpr size_t UBX_FRAME_OVERHEAD = UBX_HEADER_LENGTH + 2;
+
+    // the longest UBX frame that is framed, including the header and checksum
+    constexpr size_t MAX_UBX_FRAME_LENGTH = 1024;
+
+    /**
+     * SentenceFramer reassembles sentences ("$...\r\n") and UBX frames from a byte stream that is read in arbitrary
+     * chunks, in a single pass over the bytes. The bytes are read straight into a fixed-size ring buffer (see
+     * WritableRegion and Commit), so one read() can deliver many sentences and frames, and one that is split over
+     * several reads is delivered once it is complete. A UBX frame is delimited by the length in its header, so its
+     * binary payload cannot be mistaken for a sentence. Bytes outside of a sentence or frame, sentences longer than
+     * MAX_SENTENCE_LENGTH and frames longer than MAX_UBX_FRAME_LENGTH are discarded.
+     */
+    class SentenceFramer {
+    public:
+        static constexpr size_t BUFFER_SIZE = 4096;
+
+        /**
+         * WritableRegion returns the contiguous free space that the next chunk can be read into.
+         */
+        std::pair<char *, size_t> WritableRegion() {
+            auto free = BUFFER_SIZE - static_cast<size_t>(tail - head);
+            auto offset = static_cast<size_t>(tail % BUFFER_SIZE);
+            return {buffer.data() + offset, std::min(free, BUFFER_SIZE - offset)};
+        }
+
+        /**
+         * Commit frames the length bytes that were written into the WritableRegion. It calls
+         * onSentence(std::string_view) for every sentence they complete, excluding the line ending, and
+         * onUBX(const uint8_t *frame, size_t length) for every UBX frame, whose checksum has not been verified. Both
+         * are only valid for the duration of the call.
+         */
+        template<typename F, typename G>
+        void Commit(size_t length, F &&onSentence, G &&onUBX) {
+            for (auto end = tail + length; tail != end; tail++) {
+                auto c = static_cast<uint8_t>(buffer[tail % BUFFER_SIZE]);
+                if (st == UBX_FRAME) {
+                    /* the number of bytes of the frame so far, including this one */
+                    auto n = static_cast<size_t>(tail - start) + 1;
+                    if (n == 2 && c != UBX_SYNC_2) {
+                        /* not a frame after all; the byte may start something else */
+                        st = IDLE;
+                    } else {
+                        if (n == UBX_HEADER_LENGTH) {
+                            frameLength = (c << 8 | static_cast<uint8_t>(buffer[(tail - 1) % BUFFER_SIZE])) +
+                                          UBX_FRAME_OVERHEAD;
+                            if (frameLength > MAX_UBX_FRAME_LENGTH) {
+                                st = IDLE;
+                            }
+                        } else if (n > UBX_HEADER_LENGTH && n == frameLength) {
+                            deliverUBX(tail + 1, onUBX);
+                            st = IDLE;
+                        }
+                        continue;
+                    }
+                }
+                if (c == '$') {
+                    /* a start delimiter always starts a new sentence, dropping an incomplete one */
+                    start = tail;
+                    st = SENTENCE;
+                } else if (c == UBX_SYNC_1) {
+                    /* never part of a sentence, which is ASCII */
+                    start = tail;
+                    st = UBX_FRAME;
+                } else if (st == SENTENCE) {
+                    if (c == '\n') {
+                        deliver(tail, onSentence);
+                        st = IDLE;
+                    } else if (tail - start >= MAX_SENTENCE_LENGTH) {
+                        st = IDLE;
+                    }
+                }
+            }
+            /* everything before the start of an incomplete sentence or frame can be overwritten */
+            head = st != IDLE ? start : tail;
+        }
+
+        // Commit frames sentences only; UBX frames are skipped
+        template<typename F>
+        void Commit(size_t length, F &&onSentence) {
+            Commit(length, onSentence, [](const uint8_t *, size_t) {});
+        }
+
+        /**
+         * Push copies data into the buffer and frames it, for data that was not read into the WritableRegion.
+         */
+        template<typename F, typename G>
+        void Push(const char *data, size_t length, F &&onSentence, G &&onUBX) {
+            while (length > 0) {
+                auto region = WritableRegion();
+                auto n = std::min(length, region.second);
+                std::memcpy(region.first, data, n);
+                Commit(n, onSentence, onUBX);
+                data += n;
+                length -= n;
+            }
+        }
+
+        template<typename F>
+        void Push(const char *data, size_t length, F &&onSentence) {
+            Push(data, length, onSentence, [](const uint8_t *, size_t) {});
+        }
+
+    private:
+        enum state {
+            IDLE,
+            SENTENCE,
+            UBX_FRAME
+        };
+
+        // makes the bytes from start up to end contiguous, copying them to the scratch buffer if they wrap around
+        const char *contiguous(uint64_t end) {
+            auto length = static_cast<size_t>(end - start);
+            auto offset = static_cast<size_t>(start % BUFFER_SIZE);
+            if (offset + length <= BUFFER_SIZE) {
+                return buffer.data() + offset;
+            }
+            auto first = BUFFER_SIZE - offset;
+            std::memcpy(scratch.data(), buffer.data() + offset, first);
+            std::memcpy(scratch.data() + first, buffer.data(), length - first);
+            return scratch.data();
+        }
+
+        template<typename F>
+        void deliver(uint64_t end, F &&onSentence) {
+            if (end > start && buffer[(end - 1) % BUFFER_SIZE] == '\r') {
+                end--;
+            }
+            onSentence(std::string_view(contiguous(end), static_cast<size_t>(end - start)));
+        }
+
+        template<typename G>
+        void deliverUBX(uint64_t end, G &&onUBX) {
+            onUBX(reinterpret_cast<const uint8_t *>(contiguous(end)), static_cast<size_t>(end - start));
+        }
+
+        std::array<char, BUFFER_SIZE> buffer{};
+        std::array<char, std::max(MAX_SENTENCE_LENGTH + 1, MAX_UBX_FRAME_LENGTH)> scratch{};
+        // positions in the stream; the buffer index is the position modulo BUFFER_SIZE
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        uint64_t start = 0;
+        state st = IDLE;
+        // the length of the UBX frame being framed, once its header is complete
+        size_t frameLength = 0;
+    };
+
+    /**
+     * IncrementalParser is a push-style parser for byte streams: sentences are tokenized, checksummed and (for GGA)
+     * decoded field by field while the bytes arrive, so the result is available as soon as the second checksum digit
+     * has been fed, without a parse step after the end of the line.
+     */
+    class IncrementalParser {
+    public:
+        /**
+         * @param onSentence called with every sentence (without the line ending) whose checksum matches
+         * @param onGGA called with every valid GGA sentence, decoded; may be empty
+         */
+        explicit IncrementalParser(std::function<void(std::string_view)> onSentence,
+                                   std::function<void(const GGAFix &)> onGGA = nullptr);
+
+        // Feed processes the next chunk of the stream, which may end anywhere within a sentence.
+        void Feed(const char *data, size_t length);
+
+        // the number of sentences discarded because their checksum did not match
+        uint64_t RejectedSentences() const;
+
+    private:
+        enum state {
+            WAIT_START,
+            ADDRESS,
+            AFTER_ADDRESS,
+            FIELDS,
+            CHECKSUM
+        };
+
+        void endField();
+
+        void endSentence();
+
+        std::function<void(std::string_view)> onSentence;
+        std::function<void(const GGAFix &)> onGGA;
+        state st = WAIT_START;
+        std::array<char, MAX_SENTENCE_LENGTH> buffer{};
+        size_t length = 0;
+        size_t fieldStart = 0;
+        size_t fieldIndex = 0;
+        uint8_t checksum = 0;
+        uint8_t expectedChecksum = 0;
+        int checksumDigits = 0;
+        bool isGGA = false;
+        bool validGGA = false;
+        GGAFix fix;
+        uint64_t rejectedSentences = 0;
+    };
+
+    /**
+     * SPSCQueue is a bounded, lock-free queue of trivially copyable values between exactly one producer thread and one
+     * consumer thread. The capacity is rounded up to a power of two. Besides the usual TryPush, the producer can
+     * PushOverwrite, which makes room by discarding the oldest value. To make that safe the consumer claims a value
+     * with a compare-and-swap on the read index before copying it, and each slot carries a sequence number that tells
+     * the producer when the copy has finished and the slot may be written again. Neither side waits for the other: a
+     * slot the consumer is still copying out of counts as full.
+     */
+    template<typename T>
+    class SPSCQueue {
+        static_assert(std::is_trivially_copyable_v<T>, "SPSCQueue values are copied byte-wise");
+
+    public:
+        explicit SPSCQueue(size_t capacity) {
+            size_t n = 1;
+            while (n < capacity) {
+                n <<= 1;
+            }
+            slots = std::make_unique<slot[]>(n);
+            for (size_t i = 0; i < n; i++) {
+                slots[i].Sequence.store(i, std::memory_order_relaxed);
+            }
+            slotCount = n;
+            mask = n - 1;
+        }
+
+        size_t Capacity() const {
+            return slotCount;
+        }
+
+        size_t Size() const {
+            /* the read index never passes the write index, so load it first; from a third thread the write index may
+             * have moved on by more than a lap since */
+            auto r = readIndex.load(std::memory_order_acquire);
+            auto w = writeIndex.load(std::memory_order_acquire);
+            return static_cast<size_t>(std::min<uint64_t>(w - r, slotCount));
+        }
+
+        bool Empty() const {
+            return Size() == 0;
+        }
+
+        // Full tells whether TryPush would fail. Producer only.
+        bool Full() const {
+            auto w = writeIndex.load(std::memory_order_relaxed);
+            return w - readIndex.load(std::memory_order_acquire) == slotCount ||
+                   slots[w & mask].Sequence.load(std::memory_order_acquire) != w;
+        }
+
+        // TryPush appends the value, or returns false if the queue is full. Producer only.
+        bool TryPush(const T &value) {
+            auto w = writeIndex.load(std::memory_order_relaxed);
+            if (w - readIndex.load(std::memory_order_acquire) == slotCount) {
+                return false;
+            }
+            return tryWrite(w, value);
+        }
+
+        /**
+         * PushOverwrite appends the value, discarding the oldest one if the queue is full. If the consumer is still
+         * copying out of the slot the value would go to, the value itself is discarded instead. Producer only.
+         * @return false if a value was discarded
+         */
+        bool PushOverwrite(const T &value) {
+            auto w = writeIndex.load(std::memory_order_relaxed);
+            auto r = readIndex.load(std::memory_order_acquire);
+            bool discarded = false;
+            /* if the exchange fails the consumer has just claimed the oldest value, which makes room as well */
+            if (w - r == slotCount &&
+                readIndex.compare_exchange_strong(r, r + 1, std::memory_order_acq_rel)) {
+                /* the discarded value is never copied, so its slot is free for the value that replaces it */
+                slots[r & mask].Sequence.store(w, std::memory_order_relaxed);
+                discarded = true;
+            }
+            return tryWrite(w, value) && !discarded;
+        }
+
+        // TryPop takes the oldest value, or returns false if the queue is empty. Consumer only.
+        bool TryPop(T &value) {
+            auto r = readIndex.load(std::memory_order_acquire);
+            while (r != writeIndex.load(std::memory_order_acquire)) {
+                /* on failure the producer discarded the value; r now holds the new read index */
+                if (readIndex.compare_exchange_weak(r, r + 1, std::memory_order_acq_rel)) {
+                    auto &s = slots[r & mask];
+                    value = s.Value;
+                    /* hand the slot back to the producer, for the value one lap ahead */
+                    s.Sequence.store(r + slotCount, std::memory_order_release);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct slot {
+            // the index of the value the slot may be written with next
+            std::atomic<uint64_t> Sequence;
+            T Value;
+        };
+
+        // stores the value at index w, unless the consumer is still copying the value before it out of the same slot
+        bool tryWrite(uint64_t w, const T &value) {
+            auto &s = slots[w & mask];
+            if (s.Sequence.load(std::memory_order_acquire) != w) {
+                return false;
+            }
+            s.Value = value;
+            writeIndex.store(w + 1, std::memory_order_release);
+            return true;
+        }
+
+        std::unique_ptr<slot[]> slots;
+        size_t slotCount;
+        size_t mask;
+        // positions in the stream, on separate cache lines so that producer and consumer do not contend
+        alignas(64) std::atomic<uint64_t> readIndex{0};
+        alignas(64) std::atomic<uint64_t> writeIndex{0};
+    };
+
+    // what Read does with a sentence when the dispatch queue is full
+    enum OverflowPolicy {
+        OVERFLOW_DROP_OLDEST = 0,
+        OVERFLOW_DROP_NEWEST,
+        OVERFLOW_BLOCK
+    };
+
+    // the outcome of a configuration command that the receiver acknowledges
+    enum AckStatus {
+        ACK_OK = 0,
+        // the receiver answered with UBX-ACK-NAK, e.g. for a value out of range
+        ACK_REJECTED,
+        // no answer arrived in time; Read must be running for answers to be received
+        ACK_TIMEOUT,
+        ACK_WRITE_FAILED,
+        // not sent, as the output would no longer fit the baud rate afterwards (see NeoM8N::LinkUtilisation)
+        ACK_LINK_OVERLOADED,
+        // not sent, as an argument is out of range
+        ACK_INVALID_ARGUMENT
+    };
+
+    // CommandCallback receives the outcome of a command sent with NeoM8N::SendCommand
+    typedef std::function<void(AckStatus status)> CommandCallback;
+
+    class UnsupportedBaudRateError : public std::exception {
+        virtual const char *what() const noexcept override;
+    };
+
+    // DeviceError is thrown when a device, file or socket cannot be opened
+    class DeviceError : public std::exception {
+    public:
+        explicit DeviceError(std::string message);
+
+        virtual const char *what() const noexcept override;
+
+    private:
+        std::string message;
+    };
+
+    // UBX message classes and IDs
+    constexpr uint8_t UBX_CLASS_NAV = 0x01;
+    constexpr uint8_t UBX_CLASS_ACK = 0x05;
+    constexpr uint8_t UBX_CLASS_CFG = 0x06;
+    // the class that NMEA sentences have in UBX configuration messages
+    constexpr uint8_t UBX_CLASS_NMEA = 0xf0;
+    constexpr uint8_t UBX_ID_NAV_PVT = 0x07;
+    constexpr uint8_t UBX_ID_CFG_PRT = 0x00;
+    constexpr uint8_t UBX_ID_CFG_MSG = 0x01;
+    constexpr uint8_t UBX_ID_CFG_RATE = 0x08;
+    constexpr uint8_t UBX_ID_ACK_NAK = 0x00;
+    constexpr uint8_t UBX_ID_ACK_ACK = 0x01;
+
+    constexpr size_t NAV_PVT_LENGTH = 92;
+
+    // the receiver's UART that the host is connected to
+    constexpr uint8_t UBX_PORT_UART1 = 1;
+
+    // the time system that UBX-CFG-RATE aligns the measurements to
+    constexpr uint16_t UBX_TIME_REF_UTC = 0;
+    constexpr uint16_t UBX_TIME_REF_GPS = 1;
+
+    /**
+     * UBXChecksum calculates the 8-bit Fletcher checksum of a UBX frame, over the class, ID, length and payload.
+     */
+    void UBXChecksum(const uint8_t *data, size_t length, uint8_t &ckA, uint8_t &ckB);
+
+    /**
+     * EncodeUBX frames a UBX message: sync characters, class, ID, little-endian payload length, payload and checksum.
+     */
+    std::vector<uint8_t> EncodeUBX(uint8_t messageClass, uint8_t messageID, const std::vector<uint8_t> &payload);
+
+    /**
+     * EncodeCFGPRT builds a UBX-CFG-PRT message that configures a UART of the receiver for 8N1 at the given baud
+     * rate, with UBX and NMEA enabled in both directions.
+     */
+    std::vector<uint8_t> EncodeCFGPRT(uint32_t baudRate, uint8_t portID = UBX_PORT_UART1);
+
+    /**
+     * EncodeCFGMSG builds a UBX-CFG-MSG message that sets the output rate of a message on the port the command is
+     * received on: 0 disables it, n outputs it every n-th navigation solution.
+     */
+    std::vector<uint8_t> EncodeCFGMSG(uint8_t messageClass, uint8_t messageID, uint8_t rate);
+
+    /**
+     * EncodeCFGRATE builds a UBX-CFG-RATE message that sets the interval between measurements, in milliseconds, and
+     * the number of measurements per navigation solution.
+     */
+    std::vector<uint8_t> EncodeCFGRATE(uint16_t measurementPeriod, uint16_t navigationRate = 1,
+                                       uint16_t timeReference = UBX_TIME_REF_GPS);
+
+    /**
+     * EstimatedSentenceBytes is the number of bytes the receiver outputs for a sentence type per navigation solution,
+     * estimated for GPS and GLONASS in view (several GSV and GSA sentences per solution).
+     */
+    size_t EstimatedSentenceBytes(SentenceType type);
+
+    // NMEAMessageID returns the UBX message ID of a sentence type, in class UBX_CLASS_NMEA
+    uint8_t NMEAMessageID(SentenceType type);
+
+    // UBXFrame is a decoded UBX frame; the payload points into the buffer the frame was decoded from
+    struct UBXFrame {
+        uint8_t Class = 0;
+        uint8_t ID = 0;
+        const uint8_t *Payload = nullptr;
+        size_t PayloadLength = 0;
+    };
+
+    /**
+     * DecodeUBX checks a complete UBX frame: the sync characters, that the length field matches the length of the
+     * frame, and the checksum.
+     * @return PARSE_INVALID_SENTENCE if the frame is malformed or PARSE_CHECKSUM_MISMATCH
+     */
+    ParseStatus DecodeUBX(const uint8_t *data, size_t length, UBXFrame &frame);
+
+    // UBXCallback receives a UBX frame whose checksum matched; the payload is only valid for the duration of the call
+    typedef std::function<void(const UBXFrame &frame)> UBXCallback;
+
+    /**
+     * NavPVTView is a view of the payload of a UBX-NAV-PVT message (navigation position, velocity and time): each
+     * accessor is a single little-endian load from the payload, which must outlive the view. The units are those of
+     * the message, as documented for each field.
+     */
+    class NavPVTView {
+    public:
+        NavPVTView() = default;
+
+        // @param payload NAV_PVT_LENGTH bytes
+        explicit NavPVTView(const uint8_t *payload) : payload(payload) {}
+
+        // GPS time of week of the navigation epoch, in ms
+        uint32_t TimeOfWeek() const { return field<uint32_t>(0); }
+
+        // UTC date and time
+        uint16_t Year() const { return field<uint16_t>(4); }
+
+        uint8_t Month() const { return field<uint8_t>(6); }
+
+        uint8_t Day() const { return field<uint8_t>(7); }
+
+        uint8_t Hour() const { return field<uint8_t>(8); }
+
+        uint8_t Minute() const { return field<uint8_t>(9); }
+
+        uint8_t Second() const { return field<uint8_t>(10); }
+
+        bool ValidDate() const { return field<uint8_t>(11) & 0x01; }
+
+        bool ValidTime() const { return field<uint8_t>(11) & 0x02; }
+
+        // time accuracy estimate, in ns
+        uint32_t TimeAccuracy() const { return field<uint32_t>(12); }
+
+        // fraction of a second, in ns, -1e9..1e9
+        int32_t Nanoseconds() const { return field<int32_t>(16); }
+
+        // 0: no fix, 1: dead reckoning only, 2: 2D, 3: 3D, 4: GNSS and dead reckoning, 5: time only
+        uint8_t FixType() const { return field<uint8_t>(20); }
+
+        // whether the fix is within the configured accuracy masks
+        bool FixOK() const { return field<uint8_t>(21) & 0x01; }
+
+        bool DifferentialCorrections() const { return field<uint8_t>(21) & 0x02; }
+
+        uint8_t NumberOfSatellites() const { return field<uint8_t>(23); }
+
+        // in 1e-7 degrees
+        int32_t LongitudeE7() const { return field<int32_t>(24); }
+
+        int32_t LatitudeE7() const { return field<int32_t>(28); }
+
+        // in degrees, negative to the west and south
+        double Longitude() const { return LongitudeE7() * 1e-7; }
+
+        double Latitude() const { return LatitudeE7() * 1e-7; }
+
+        // height above the ellipsoid and above mean sea level, in mm
+        int32_t Height() const { return field<int32_t>(32); }
+
+        int32_t HeightMSL() const { return field<int32_t>(36); }
+
+        // horizontal and vertical accuracy estimates, in mm
+        uint32_t HorizontalAccuracy() const { return field<uint32_t>(40); }
+
+        uint32_t VerticalAccuracy() const { return field<uint32_t>(44); }
+
+        // NED velocity, in mm/s
+        int32_t VelocityNorth() const { return field<int32_t>(48); }
+
+        int32_t VelocityEast() const { return field<int32_t>(52); }
+
+        int32_t VelocityDown() const { return field<int32_t>(56); }
+
+        // 2D ground speed, in mm/s
+        int32_t GroundSpeed() const { return field<int32_t>(60); }
+
+        // 2D heading of motion, in 1e-5 degrees
+        int32_t HeadingOfMotion() const { return field<int32_t>(64); }
+
+        // speed accuracy estimate, in mm/s
+        uint32_t SpeedAccuracy() const { return field<uint32_t>(68); }
+
+        // heading accuracy estimate, in 1e-5 degrees
+        uint32_t HeadingAccuracy() const { return field<uint32_t>(72); }
+
+        // position DOP, in 0.01
+        uint16_t PDOP() const { return field<uint16_t>(76); }
+
+    private:
+        // a single (unaligned) load on little-endian hosts, which UBX is
+        template<typename T>
+        T field(size_t offset) const {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            std::make_unsigned_t<T> v = 0;
+            for (size_t i = sizeof(T); i-- > 0;) {
+                v = static_cast<std::make_unsigned_t<T>>((v << 8) | payload[offset + i]);
+            }
+            return static_cast<T>(v);
+#else
+            T v;
+            std::memcpy(&v, payload + offset, sizeof(T));
+            return v;
+#endif
+        }
+
+        const uint8_t *payload = nullptr;
+    };
+
+    /**
+     * TryParseNavPVT makes a view of a decoded frame.
+     * @return PARSE_NO_MATCHING_TYPE if the frame is not a UBX-NAV-PVT message, PARSE_INVALID_SENTENCE if its payload
+     * does not have the expected length
+     */
+    ParseStatus TryParseNavPVT(const UBXFrame &frame, NavPVTView &view);
+
+    // TryParseNavPVT decodes a complete frame and makes a view of it
+    ParseStatus TryParseNavPVT(const uint8_t *data, size_t length, NavPVTView &view);
+
+    /**
+     * SentenceTraits maps each parsed representation of a sentence to its type and parser, for typed subscriptions.
+     */
+    template<typename T>
+    struct SentenceTraits;
+
+#define NEOM8N_SENTENCE_TRAITS(T, TYPE, PARSE) \
+    template<> \
+    struct SentenceTraits<T> { \
+        static constexpr SentenceType Type = TYPE; \
+        static ParseStatus Parse(std::string_view s, T &v) { return PARSE(s, v); } \
+    };
+
+    NEOM8N_SENTENCE_TRAITS(GGA, GGA_TYPE, TryParseGGA)
+    NEOM8N_SENTENCE_TRAITS(GGAView, GGA_TYPE, TryParseGGA)
+    NEOM8N_SENTENCE_TRAITS(GGAFix, GGA_TYPE, TryParseGGA)
+    NEOM8N_SENTENCE_TRAITS(GSV, GSV_TYPE, TryParseGSV)
+    NEOM8N_SENTENCE_TRAITS(GSVView, GSV_TYPE, TryParseGSV)
+    NEOM8N_SENTENCE_TRAITS(ZDA, ZDA_TYPE, TryParseZDA)
+    NEOM8N_SENTENCE_TRAITS(ZDAView, ZDA_TYPE, TryParseZDA)
+    NEOM8N_SENTENCE_TRAITS(GSA, GSA_TYPE, TryParseGSA)
+    NEOM8N_SENTENCE_TRAITS(GSAView, GSA_TYPE, TryParseGSA)
+    NEOM8N_SENTENCE_TRAITS(VTG, VTG_TYPE, TryParseVTG)
+    NEOM8N_SENTENCE_TRAITS(VTGView, VTG_TYPE, TryParseVTG)
+    NEOM8N_SENTENCE_TRAITS(GLL, GLL_TYPE, TryParseGLL)
+    NEOM8N_SENTENCE_TRAITS(GLLView, GLL_TYPE, TryParseGLL)
+    NEOM8N_SENTENCE_TRAITS(TXT, TXT_TYPE, TryParseTXT)
+    NEOM8N_SENTENCE_TRAITS(TXTView, TXT_TYPE, TryParseTXT)
+    NEOM8N_SENTENCE_TRAITS(RMC, RMC_TYPE, TryParseRMC)
+    NEOM8N_SENTENCE_TRAITS(RMCView, RMC_TYPE, TryParseRMC)
+
+#undef NEOM8N_SENTENCE_TRAITS
+
+    /**
+     * ByteSource is a stream NeoM8N reads sentences from and writes commands to: a serial port, a recording, a
+     * simulator or a network connection. A source owns its descriptor and closes it when it is destroyed; it throws
+     * DeviceError if it cannot be opened.
+     */
+    class ByteSource {
+    public:
+        virtual ~ByteSource();
+
+        ByteSource(const ByteSource &) = delete;
+
+        ByteSource &operator=(const ByteSource &) = delete;
+
+        // the descriptor to poll and read; data written to it is sent to the receiver where the source allows that
+        int Fd() const;
+
+        /**
+         * SetSpeed switches the host side of the link to a new baud rate once the pending output has been sent. Only
+         * serial ports have a baud rate; for other sources it does nothing.
+         */
+        virtual void SetSpeed(unsigned int baudRate);
+
+    protected:
+        explicit ByteSource(int fd);
+
+        int fd;
+    };
+
+    // SerialSource is a serial device, configured raw, non-blocking and 8N1; its old settings are restored at the end
+    class SerialSource : public ByteSource {
+    public:
+        /**
+         * @param device the serial device the receiver is connected to
+         * @param baudRate the baud rate the receiver is configured for; throws UnsupportedBaudRateError for rates the
+         * host does not support
+         */
+        explicit SerialSource(const std::string &device, unsigned int baudRate = 9600);
+
+        ~SerialSource() override;
+
+        void SetSpeed(unsigned int baudRate) override;
+
+    private:
+        struct termios oldSettings{}, newSettings{};
+    };
+
+    // FileSource replays a recording from a regular file or named pipe; NeoM8N::Read returns at its end
+    class FileSource : public ByteSource {
+    public:
+        explicit FileSource(const std::string &path);
+    };
+
+    // DescriptorSource reads a descriptor that is already open, e.g. STDIN_FILENO or one end of a pipe or socket pair
+    class DescriptorSource : public ByteSource {
+    public:
+        // @param owned whether the descriptor is closed with the source; pass false e.g. for STDIN_FILENO
+        explicit DescriptorSource(int fd, bool owned = true);
+
+        ~DescriptorSource() override;
+
+    private:
+        bool owned;
+    };
+
+    /**
+     * PseudoTerminalSource creates a pseudo terminal and reads its master side, so that a simulator can play the
+     * receiver by writing to the terminal named by SlaveName. The terminal is raw, so line endings are passed on
+     * unchanged, and it is kept open by the source, so that the stream does not end when the simulator closes it.
+     */
+    class PseudoTerminalSource : public ByteSource {
+    public:
+        PseudoTerminalSource();
+
+        ~PseudoTerminalSource() override;
+
+        const std::string &SlaveName() const;
+
+    private:
+        int slaveFd;
+        std::string slaveName;
+    };
+
+    // SocketSource connects to a receiver streamed over TCP, e.g. by a serial-to-network bridge, or a Unix socket
+    class SocketSource : public ByteSource {
+    public:
+        // connects to host:port over TCP
+        SocketSource(const std::string &host, uint16_t port);
+
+        // connects to the Unix domain stream socket at path
+        explicit SocketSource(const std::string &path);
+    };
+
     class NeoM8N {
     public:
-        NeoM8N(const std::string &device);
+        /**
+         * @param device the serial device the receiver is connected to
+         * @param baudRate the baud rate the receiver is currently configured for, between 4800 and 921600 (9600 is
+         * the receiver's default); throws UnsupportedBaudRateError for rates the host does not support, and
+         * DeviceError if the device cannot be opened
+         */
+        NeoM8N(const std::string &device, unsigned int baudRate = 9600);
+
+        /**
+         * @param source the stream to read the receiver from
+         * @param baudRate the baud rate the receiver is configured for, as reported by BaudRate
+         */
+        explicit NeoM8N(std::unique_ptr<ByteSource> source, unsigned int baudRate = 9600);
 
         ~NeoM8N();
 
+        /**
+         * RegisterCallback registers (or replaces) the callback with the given key. All callbacks are handed a view of
+         * the same receive buffer, so fanning a sentence out to any number of them does not allocate.
+         * Callbacks and subscriptions may be (de)registered from any thread, also while Read is running: Read keeps
+         * using an immutable snapshot of the registry and picks up changes from the next sentence, so a callback can
+         * still be running while it is deregistered.
+         */
+        void RegisterCallback(const std::string &key, SentenceCallback cb);
+
+        /**
+         * RegisterCallback registers a callback that receives its own copy of each sentence, for compatibility.
+         */
         void RegisterCallback(const std::string &key, GPSCallback cb);
 
+        // resolves callables that accept a std::string_view, which would otherwise match both overloads
+        template<typename F, typename = std::enable_if_t<std::is_invocable_v<F &, std::string_view> &&
+                                                         !std::is_same_v<std::decay_t<F>, SentenceCallback> &&
+                                                         !std::is_same_v<std::decay_t<F>, GPSCallback>>>
+        void RegisterCallback(const std::string &key, F cb) {
+            RegisterCallback(key, SentenceCallback(std::move(cb)));
+        }
+
         void DeregisterCallback(const std::string &key);
 
+        /**
+         * RegisterUBXCallback registers (or replaces) a callback for the UBX frames the receiver sends. Read frames
+         * them from the same stream as the sentences, so binary output can be enabled next to NMEA; frames with a
+         * mismatching checksum are discarded, as are frames longer than MAX_UBX_FRAME_LENGTH.
+         */
+        void RegisterUBXCallback(const std::string &key, UBXCallback cb);
+
+        void DeregisterUBXCallback(const std::string &key);
+
+        /**
+         * Subscribe registers (or replaces) a handler for one parsed representation of a sentence type, e.g.
+         * Subscribe<neom8n::GGAFix>("key", handler). Read parses each sentence at most once per representation, and
+         * only if there is a handler for it; sentences that fail to parse are not delivered. Views passed to the
+         * handler are only valid for the duration of the call.
+         */
+        template<typename T>
+        void Subscribe(const std::string &key, std::function<void(const T &)> handler) {
+            updateRegistry([&](callbackRegistry &r) {
+                auto &groups = r.Subscriptions[SentenceTraits<T>::Type];
+                for (auto &g : groups) {
+                    if (auto typed = dynamic_cast<const subscriptionGroup<T> *>(g.get())) {
+                        auto copy = std::make_shared<subscriptionGroup<T>>(*typed);
+                        setKeyed(copy->Handlers, key, std::move(handler));
+                        g = std::move(copy);
+                        return;
+                    }
+                }
+                auto group = std::make_shared<subscriptionGroup<T>>();
+                setKeyed(group->Handlers, key, std::move(handler));
+                groups.push_back(std::move(group));
+            });
+        }
+
+        // Unsubscribe removes the typed handlers registered with the given key.
+        void Unsubscribe(const std::string &key);
+
+        /**
+         * Read streams sentences from the source to the registered callbacks until Stop is called, the source ends or
+         * the receiver is destroyed. It blocks in poll() while there is no data, so sentences are delivered as soon as
+         * they arrive. Each read() drains everything the source has buffered, which is framed into sentences (without
+         * the line ending) by a SentenceFramer.
+         * Only one Read runs at a time; concurrent calls wait for the running one to return.
+         */
         void Read();
 
+        /**
+         * Stop makes the running (or, if none is running, the next) Read return promptly. It may be called from any
+         * thread.
+         */
+        void Stop();
+
+        // the number of sentences and UBX frames Read discarded because their checksum did not match
+        uint64_t RejectedSentences() const;
+
+        /**
+         * SetDispatchQueue decouples the callbacks from reading the port: Read only frames and checks sentences and
+         * pushes them into a lock-free queue with room for the given number of sentences, which a dispatch thread
+         * drains into the callbacks and subscriptions. Each slot holds up to MAX_UBX_FRAME_LENGTH bytes, so UBX frames
+         * are queued like sentences. When the queue is full the policy decides whether the oldest or the newest
+         * sentence is dropped, or whether Read waits for room; only with OVERFLOW_BLOCK does Read ever wait for the
+         * dispatch thread. A capacity of 0 (the default) runs the callbacks on the Read thread. Takes effect from the next Read; sentences still queued when Read returns are
+         * delivered before it does.
+         */
+        void SetDispatchQueue(size_t capacity, OverflowPolicy policy = OVERFLOW_DROP_OLDEST);
+
+        // the number of sentences dropped because the dispatch queue was full
+        uint64_t DroppedSentences() const;
+
+        /**
+         * SetBaudRate switches the receiver's UART1 and the host port to a new baud rate in lock-step: it sends
+         * UBX-CFG-PRT at the current rate, waits until it has been transmitted, re-applies the port settings at the new
+         * rate and then waits for the receiver to acknowledge the change, which arrives through Read (see
+         * SendCommand). If the receiver rejects the command, the host port is switched back. The receiver switches
+         * before it answers, so the acknowledgement can be lost; if none arrives, the receiver is polled at the new
+         * rate and then at the old one. The host port stays at the new rate if the receiver answers there (ACK_OK)
+         * and is switched back otherwise (ACK_TIMEOUT). For sources other than serial ports only the command is sent. A rate too low for
+         * the enabled output is refused (see LinkUtilisation).
+         */
+        AckStatus SetBaudRate(unsigned int baudRate,
+                              std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        unsigned int BaudRate() const;
+
+        /**
+         * SetSentenceOutput makes the receiver output the given sentence types on its port, once per navigation
+         * solution, and none of the others, by sending a UBX-CFG-MSG command for each type. Sentences that are not
+         * sent do not take up the link's bandwidth, nor the host's CPU to read and discard them. The commands are
+         * pipelined and their acknowledgements arrive through Read (see SendCommand). If the given types would not
+         * fit the baud rate at the navigation rate, none of the commands is sent (see LinkUtilisation).
+         * @return the outcome of the command for each sentence type, indexed by SentenceType
+         */
+        std::array<AckStatus, SENTENCE_TYPE_COUNT> SetSentenceOutput(
+                const std::vector<SentenceType> &types,
+                std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        /**
+         * PruneSentenceOutput limits the receiver's output to the sentence types that have typed subscriptions (see
+         * Subscribe). Callbacks registered with RegisterCallback are not taken into account, as they may want any
+         * type; don't prune while relying on them for types without subscriptions.
+         * @return the outcome of the command for each sentence type, as for SetSentenceOutput
+         */
+        std::array<AckStatus, SENTENCE_TYPE_COUNT> PruneSentenceOutput(
+                std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        // the sentence types that have typed subscriptions
+        std::vector<SentenceType> SubscribedSentenceTypes() const;
+
+        /**
+         * SetNavigationRate sets how often the receiver computes a fix, and so outputs its sentences, with UBX-CFG-RATE
+         * and waits for the receiver to acknowledge it, e.g. SetNavigationRate(100) for 10 Hz. The NEO-M8N supports
+         * up to 18 Hz with a single constellation and 10 Hz with several. The acknowledgement arrives through Read,
+         * which has to be running on another thread. A rate at which the enabled output would not fit the baud rate
+         * is refused (see LinkUtilisation); disable sentences or raise the baud rate first.
+         * @param measurementPeriod the interval between measurements, in milliseconds; 0 is refused with
+         * ACK_INVALID_ARGUMENT
+         * @param navigationRate the number of measurements per navigation solution; 0 is refused with
+         * ACK_INVALID_ARGUMENT
+         */
+        AckStatus SetNavigationRate(uint16_t measurementPeriod, uint16_t navigationRate = 1,
+                                    std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        /**
+         * SendCommand writes a UBX-CFG command and returns without waiting for the receiver to answer, so that any
+         * number of commands can be in flight: a full configuration takes one round trip instead of one per command.
+         * Read matches each UBX-ACK-ACK or UBX-ACK-NAK to the oldest outstanding command with its class and ID (the
+         * receiver answers in order) and calls the callback on the Read thread; commands that are not answered within
+         * the timeout complete with ACK_TIMEOUT. Read has to be running for commands to complete before their timeout.
+         * The callback must not block, as it holds up Read. Unlike SetNavigationRate, this does not update the
+         * receiver state that NeoM8N keeps.
+         */
+        void SendCommand(const std::vector<uint8_t> &command, CommandCallback done,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        // SendCommand returns a future for the outcome of the command instead of calling back
+        std::future<AckStatus> SendCommand(const std::vector<uint8_t> &command,
+                                           std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+        // the number of navigation solutions per second, as last acknowledged by the receiver (1 by default)
+        double NavigationRate() const;
+
+        /**
+         * LinkUtilisation estimates the fraction of the link's bandwidth the receiver's NMEA output takes, from the
+         * sentence types set by SetSentenceOutput (the receiver's default set otherwise), the navigation rate and the
+         * baud rate. Above 1 the receiver drops output and the fixes arrive late; UBX output enabled separately is not
+         * accounted for. SetBaudRate, SetSentenceOutput and SetNavigationRate keep it at or below 1: they refuse a
+         * change after which it would exceed 1 with ACK_LINK_OVERLOADED, without sending anything. Commands sent with
+         * SendCommand are not checked.
+         */
+        double LinkUtilisation() const;
+
     private:
-        int fd;
-        std::map<std::string, GPSCallback> cbs;
-        struct termios oldPortSettings{}, newPortSettings{};
-        bool reading;
+        class subscriptionGroupBase {
+        public:
+            virtual ~subscriptionGroupBase() = default;
+
+            virtual void Dispatch(std::string_view sentence) const = 0;
+
+            /**
+             * Without returns the group without the handler with the given key: the group itself if there is no such
+             * handler, a copy otherwise, or nullptr if no handlers would be left.
+             */
+            virtual std::shared_ptr<const subscriptionGroupBase> Without(const std::string &key) const = 0;
+        };
+
+        // the handlers for one representation T, which share a single parse of each sentence
+        template<typename T>
+        class subscriptionGroup : public subscriptionGroupBase,
+                                  public std::enable_shared_from_this<subscriptionGroup<T>> {
+        public:
+            void Dispatch(std::string_view sentence) const override {
+                T parsed;
+                if (SentenceTraits<T>::Parse(sentence, parsed) != PARSE_OK) {
+                    return;
+                }
+                for (auto const &h : Handlers) {
+                    h.second(parsed);
+                }
+            }
+
+            std::shared_ptr<const subscriptionGroupBase> Without(const std::string &key) const override {
+                auto copy = std::make_shared<subscriptionGroup<T>>(*this);
+                if (!eraseKeyed(copy->Handlers, key)) {
+                    return this->shared_from_this();
+                }
+                return copy->Handlers.empty() ? nullptr : copy;
+            }
+
+            std::vector<std::pair<std::string, std::function<void(const T &)>>> Handlers;
+        };
+
+        /**
+         * callbackRegistry holds all callbacks and subscriptions in flat vectors. A published registry is never
+         * modified; changes are made to a copy which then replaces it.
+         */
+        struct callbackRegistry {
+            std::vector<std::pair<std::string, SentenceCallback>> Callbacks;
+            std::vector<std::pair<std::string, UBXCallback>> UBXCallbacks;
+            std::array<std::vector<std::shared_ptr<const subscriptionGroupBase>>, SENTENCE_TYPE_COUNT> Subscriptions;
+        };
+
+        template<typename V>
+        static void setKeyed(std::vector<std::pair<std::string, V>> &entries, const std::string &key, V value) {
+            for (auto &e : entries) {
+                if (e.first == key) {
+                    e.second = std::move(value);
+                    return;
+                }
+            }
+            entries.emplace_back(key, std::move(value));
+        }
+
+        template<typename V>
+        static bool eraseKeyed(std::vector<std::pair<std::string, V>> &entries, const std::string &key) {
+            auto it = std::find_if(entries.begin(), entries.end(), [&](const std::pair<std::string, V> &e) {
+                return e.first == key;
+            });
+            if (it == entries.end()) {
+                return false;
+            }
+            entries.erase(it);
+            return true;
+        }
+
+        // a sentence or UBX frame in the dispatch queue, stored inline so that queueing does not allocate
+        struct queuedSentence {
+            uint16_t Length;
+            bool UBX;
+            std::array<char, std::max(MAX_SENTENCE_LENGTH, MAX_UBX_FRAME_LENGTH)> Data;
+        };
+
+        /**
+         * dispatchQueue connects Read to the dispatch thread for the duration of one Read. The queue itself is
+         * lock-free; the mutex and condition variable are only used by a side that has to wait, i.e. the dispatch
+         * thread when the queue is empty and, with OVERFLOW_BLOCK, Read when it is full.
+         */
+        struct dispatchQueue {
+            explicit dispatchQueue(size_t capacity) : Queue(capacity) {}
+
+            // wakes up the other side if it is waiting
+            void Notify() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (Waiters.load() > 0) {
+                    std::lock_guard<std::mutex> lock(Mutex);
+                    Changed.notify_all();
+                }
+            }
+
+            // waits until ready() holds; the timeout only guards against a missed notification
+            template<typename P>
+            void Wait(P ready) {
+                std::unique_lock<std::mutex> lock(Mutex);
+                Waiters++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!ready()) {
+                    Changed.wait_for(lock, std::chrono::milliseconds(50));
+                }
+                Waiters--;
+            }
+
+            SPSCQueue<queuedSentence> Queue;
+            std::mutex Mutex;
+            std::condition_variable Changed;
+            std::atomic<int> Waiters{0};
+            // set once Read has pushed its last sentence
+            std::atomic<bool> Done{false};
+        };
+
+        // pushes a sentence or UBX frame into the dispatch queue, applying the overflow policy
+        void enqueue(dispatchQueue &q, std::string_view data, bool ubx);
+
+        // the dispatch thread: delivers queued sentences until the queue is drained and Done is set
+        void dispatchLoop(dispatchQueue &q);
+
+        // reloads the registry snapshot if it has changed since it was taken
+        void refreshSnapshot(std::shared_ptr<const callbackRegistry> &snapshot, uint64_t &snapshotVersion) const;
+
+        // copies the registry, applies the update to the copy and publishes it
+        void updateRegistry(const std::function<void(callbackRegistry &)> &update);
+
+        // hands the sentence to the callbacks and to the subscriptions for its type
+        static void dispatch(const callbackRegistry &r, std::string_view sentence);
+
+        // hands the frame to the UBX callbacks
+        static void dispatchUBX(const callbackRegistry &r, const UBXFrame &frame);
+
+        // checks a framed UBX frame and delivers it, directly or through the dispatch queue
+        void deliverUBX(const uint8_t *data, size_t length, dispatchQueue *queue,
+                        std::shared_ptr<const callbackRegistry> &snapshot, uint64_t &snapshotVersion);
+
+        // signals the wake-up descriptor, which interrupts a Read blocked in poll()
+        void wake();
+
+        // writes all the data to the device, waiting for it to become writable if necessary; fails when it stalls
+        bool writeAll(const uint8_t *data, size_t length);
+
+        /**
+         * sendCommand tracks and writes a command like SendCommand; the caller holds commandMutex.
+         * @return false if the command could not be written, in which case it has completed with ACK_WRITE_FAILED
+         */
+        bool sendCommand(const std::vector<uint8_t> &command, CommandCallback done, std::chrono::milliseconds timeout);
+
+        bool sendCommand(const std::vector<uint8_t> &command, std::chrono::milliseconds timeout,
+                         std::future<AckStatus> &result);
+
+        // waits for the outcome of a command, expiring it at the deadline if no running Read does; the deadline must
+        // not be before the command's own
+        AckStatus awaitCommand(std::future<AckStatus> &result, std::chrono::steady_clock::time_point deadline);
+
+        // switches the host port to the given baud rate and polls the receiver's port configuration, to find out
+        // whether the receiver is at that rate
+        bool answersAt(unsigned int baudRate, std::chrono::milliseconds timeout);
+
+        // completes the oldest command awaiting the given UBX-ACK-ACK or UBX-ACK-NAK frame
+        void acknowledge(const UBXFrame &frame);
+
+        // completes the commands whose deadline has passed by the given time with ACK_TIMEOUT
+        void expireCommands(std::chrono::steady_clock::time_point now);
+
+        // the poll() timeout until the next command deadline, in milliseconds, or -1 if no command is outstanding
+        int commandTimeout();
+
+        // the link utilisation of the given sentence types (one bit per SentenceType) at the given number of
+        // navigation solutions per second and baud rate
+        static double linkUtilisation(uint32_t types, double solutionsPerSecond, unsigned int baud);
+
+        // whether the given output fits the link; logs an error if it does not
+        static bool fitsLink(uint32_t types, double solutionsPerSecond, unsigned int baud);
+
+        // a command awaiting an acknowledgement
+        struct pendingCommand {
+            uint64_t Sequence;
+            uint8_t Class;
+            uint8_t ID;
+            std::chrono::steady_clock::time_point Deadline;
+            CommandCallback Done;
+        };
+
+        std::unique_ptr<ByteSource> source;
+        // an eventfd (or the read end of a pipe where eventfd is not available), used to wake up Read
+        int wakeReadFd;
+        int wakeWriteFd;
+        // only accessed with std::atomic_load/std::atomic_store; writers are serialised by registryMutex
+        std::shared_ptr<const callbackRegistry> registry = std::make_shared<callbackRegistry>();
+        // incremented on every update, so that Read only reloads the registry when it has changed
+        std::atomic<uint64_t> registryVersion{0};
+        std::mutex registryMutex;
+        std::atomic<unsigned int> baudRate;
+        std::atomic<bool> stopRequested{false};
+        // held by Read, so that the destructor does not close the port underneath it
+        std::mutex readMutex;
+        std::atomic<uint64_t> rejectedSentences{0};
+        std::atomic<size_t> queueCapacity{0};
+        std::atomic<OverflowPolicy> overflowPolicy{OVERFLOW_DROP_OLDEST};
+        std::atomic<uint64_t> droppedSentences{0};
+        // the dispatch queue of the running Read, so that Stop can wake up a side waiting on it
+        dispatchQueue *activeQueue = nullptr;
+        std::mutex activeQueueMutex;
+        // the sentence types the receiver outputs, one bit per SentenceType: GGA, VTG, GSV, GLL, RMC and GSA by default
+        std::atomic<uint32_t> outputTypes{(1u << GGA_TYPE) | (1u << VTG_TYPE) | (1u << GSV_TYPE) | (1u << GLL_TYPE) |
+                                          (1u << RMC_TYPE) | (1u << GSA_TYPE)};
+        std::atomic<uint16_t> measurementPeriod{1000};
+        std::atomic<uint16_t> navigationRate{1};
+        // serialises writing commands, so that they reach the receiver in the order they are tracked and none is written
+        // while SetBaudRate switches the port
+        std::mutex commandMutex;
+        std::mutex ackMutex;
+        // the outstanding commands in the order they were sent; guarded by ackMutex
+        std::list<pendingCommand> pendingCommands;
+        uint64_t commandSequence = 0;
+        // the earliest deadline of the outstanding commands, as steady_clock ticks, so that Read can check it without
+        // locking; the maximum if there are none
+        std::atomic<std::chrono::steady_clock::rep> nextDeadline{std::chrono::steady_clock::time_point::max()
+                                                                         .time_since_epoch().count()};
+    };
+
+#if defined(__linux__)
+    /**
+     * ReadBackend waits for data on a set of descriptors and reads it, for ReceiverGroup's reactor threads. Add and
+     * Wake may be called from any thread, Wait only from one.
+     */
+    class ReadBackend {
+    public:
+        /**
+         * ReadHandler receives the token the descriptor was added with and the data read, which is only valid for the
+         * duration of the call. At end of file the length is 0, on an error it is -errno; the descriptor has then been
+         * removed from the backend.
+         */
+        typedef std::function<void(void *token, const char *data, ssize_t length)> ReadHandler;
+
+        virtual ~ReadBackend() = default;
+
+        // Add starts reading the descriptor, which must remain open as long as the backend exists
+        virtual bool Add(int fd, void *token) = 0;
+
+        /**
+         * Wait blocks until data has been read from at least one descriptor or Wake has been called, and hands
+         * everything that has been read to the handler.
+         * @return false on an unrecoverable error
+         */
+        virtual bool Wait(const ReadHandler &onRead) = 0;
+
+        // Wake makes a blocked (or the next) Wait return
+        virtual void Wake() = 0;
+
+        virtual const char *Name() const = 0;
+
+        // the number of system calls Wait has made, for benchmarking
+        virtual uint64_t SystemCalls() const = 0;
+    };
+
+    enum ReadBackendType {
+        READ_BACKEND_AUTO = 0,
+        // epoll_wait, then a read() per ready descriptor
+        READ_BACKEND_EPOLL,
+        // linked poll and read requests into registered buffers, submitted and reaped with one io_uring_enter
+        READ_BACKEND_IO_URING
+    };
+
+    // the number of descriptors an io_uring backend can read unless told otherwise
+    constexpr size_t DEFAULT_MAX_DESCRIPTORS = 64;
+
+    /**
+     * MakeReadBackend creates a backend of the given type; READ_BACKEND_AUTO uses io_uring if the kernel supports it,
+     * and epoll otherwise. The io_uring backend is only built against the headers of Linux 5.17 or later; without
+     * them READ_BACKEND_AUTO always uses epoll.
+     * @param maxDescriptors the number of descriptors an io_uring backend can read, as it registers a buffer for each;
+     * its Add fails beyond that. An epoll backend has no such limit.
+     * @return nullptr if the backend is not supported
+     */
+    std::unique_ptr<ReadBackend> MakeReadBackend(ReadBackendType type,
+                                                 size_t maxDescriptors = DEFAULT_MAX_DESCRIPTORS);
+
+    // ReceiverCallback receives the id of the receiver and a view of the sentence, valid for the duration of the call
+    typedef std::function<void(int receiverId, std::string_view sentence)> ReceiverCallback;
+
+    /**
+     * ReceiverGroup reads any number of receivers with a fixed number of threads. Each reactor thread waits on a set
+     * of ports through a ReadBackend and frames and checks the sentences of all of them, so the thread count does not
+     * depend on the number of receivers. Receivers are assigned to the reactor threads round-robin; the callbacks of
+     * one receiver always run on the same thread and in order, the callbacks of receivers on different threads may run
+     * concurrently.
+     */
+    class ReceiverGroup {
+    public:
+        /**
+         * @param callback called with every sentence whose checksum matches
+         * @param threads the number of reactor threads, at least 1
+         * @param pinThreads pin reactor thread i to CPU i (modulo the number of CPUs)
+         * @param backend how the reactor threads read the ports
+         * @param expectedReceivers the number of receivers the group is sized for; with io_uring each thread reads
+         * its share of them, but at least DEFAULT_MAX_DESCRIPTORS
+         */
+        explicit ReceiverGroup(ReceiverCallback callback, unsigned int threads = 1, bool pinThreads = false,
+                               ReadBackendType backend = READ_BACKEND_AUTO,
+                               size_t expectedReceivers = DEFAULT_MAX_DESCRIPTORS);
+
+        ~ReceiverGroup();
+
+        /**
+         * AddReceiver adds a source that can be polled, i.e. anything but a regular file. Receivers may be added
+         * while Run is running. An io_uring thread that already reads as many receivers as it was sized for refuses
+         * further ones, in which case the receiver goes to another thread with room, if any.
+         * @return the id passed to the callback, or -1 if the source could not be added
+         */
+        int AddReceiver(std::unique_ptr<ByteSource> source);
+
+        // AddReceiver opens a serial device with a SerialSource; returns -1 if it could not be opened
+        int AddReceiver(const std::string &device, unsigned int baudRate = 9600);
+
+        /**
+         * AddReceiver adds an already open descriptor, e.g. a socket or pseudo terminal; the group makes it
+         * non-blocking and closes it when it is destroyed.
+         */
+        int AddReceiver(int fd);
+
+        /**
+         * Run streams the sentences of all receivers to the callback until Stop is called. It runs the first reactor
+         * thread itself and starts the others. A receiver whose port fails or hangs up is dropped from the group.
+         */
+        void Run();
+
+        // Stop makes the running (or, if none is running, the next) Run return promptly, from any thread.
+        void Stop();
+
+        // the number of sentences discarded because their checksum did not match
+        uint64_t RejectedSentences() const;
+
+    private:
+        struct receiver {
+            int Id;
+            std::unique_ptr<ByteSource> Source;
+            SentenceFramer Framer;
+        };
+
+        void runShard(size_t index);
+
+        ReceiverCallback callback;
+        bool pinThreads;
+        // the backend of each reactor thread
+        std::vector<std::unique_ptr<ReadBackend>> shards;
+        // only appended to, and the receivers never move, so the reactor threads can keep pointers to them
+        std::vector<std::unique_ptr<receiver>> receivers;
+        std::mutex receiversMutex;
+        std::atomic<bool> stopRequested{false};
+        // held by Run, so that the destructor does not close the ports underneath it
+        std::mutex runMutex;
+        std::atomic<uint64_t> rejectedSentences{0};
     };
+#endif
 }
 
 
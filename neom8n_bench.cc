@@ -0,0 +1,96 @@
+// Compares the read backends: system calls per sentence and the latency from writing a sentence to a pseudo terminal
+// until it has been framed, for a number of receivers read by one thread.
+//
+// usage: neom8n_bench [receivers] [sentences per receiver]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "neom8n.h"
+#include "pseudo_terminal.h"
+
+using std::cout;
+using std::endl;
+
+namespace {
+    typedef std::chrono::steady_clock clock_type;
+
+    std::string sentence(unsigned int sequence) {
+        char body[64];
+        snprintf(body, sizeof(body), "GPTXT,01,01,02,%08u", sequence);
+        char line[80];
+        snprintf(line, sizeof(line), "$%s*%02X\r\n", body, neom8n::Checksum(body));
+        return line;
+    }
+
+    void run(neom8n::ReadBackendType type, int receivers, unsigned int sentences) {
+        auto backend = neom8n::MakeReadBackend(type, receivers);
+        if (!backend) {
+            cout << "backend " << type << " is not supported" << endl;
+            return;
+        }
+        std::vector<PseudoTerminal> ptys(receivers);
+        std::vector<int> slaves;
+        for (auto const &pty : ptys) {
+            slaves.push_back(pty.OpenDevice(O_NONBLOCK));
+        }
+        std::vector<neom8n::SentenceFramer> framers(receivers);
+        std::vector<clock_type::time_point> sent(sentences);
+        std::vector<double> latencies;
+        latencies.reserve(receivers * sentences);
+        for (int i = 0; i < receivers; i++) {
+            backend->Add(slaves[i], &framers[i]);
+        }
+
+        std::thread writer([&]() {
+            for (unsigned int n = 0; n < sentences; n++) {
+                auto line = sentence(n);
+                sent[n] = clock_type::now();
+                for (auto const &pty : ptys) {
+                    if (write(pty.Master, line.data(), line.size()) < 0) {
+                        perror("write");
+                    }
+                }
+                /* pace the sentences, so that the latency is not dominated by queueing */
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        auto onRead = [&](void *token, const char *data, ssize_t length) {
+            if (length <= 0) {
+                return;
+            }
+            static_cast<neom8n::SentenceFramer *>(token)->Push(data, length, [&](std::string_view s) {
+                auto n = static_cast<unsigned int>(std::strtoul(std::string(s.substr(16, 8)).c_str(), nullptr, 10));
+                latencies.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - sent[n]).count());
+            });
+        };
+        auto start = clock_type::now();
+        while (latencies.size() < static_cast<size_t>(receivers) * sentences) {
+            if (!backend->Wait(onRead)) {
+                break;
+            }
+        }
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        writer.join();
+
+        std::sort(latencies.begin(), latencies.end());
+        cout << backend->Name() << ": " << latencies.size() << " sentences in " << elapsed << " s, "
+             << static_cast<double>(backend->SystemCalls()) / latencies.size() << " system calls per sentence, "
+             << "latency median " << latencies[latencies.size() / 2] << " us, p99 "
+             << latencies[latencies.size() * 99 / 100] << " us" << endl;
+        backend.reset();
+        for (auto slave : slaves) {
+            close(slave);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int receivers = argc > 1 ? std::atoi(argv[1]) : 32;
+    unsigned int sentences = argc > 2 ? std::atoi(argv[2]) : 2000;
+    run(neom8n::READ_BACKEND_EPOLL, receivers, sentences);
+    run(neom8n::READ_BACKEND_IO_URING, receivers, sentences);
+    return 0;
+}
@@ -6,6 +6,82 @@
 
 #include "catch.hpp"
 #include "neom8n.h"
+#include "pseudo_terminal.h"
+#include <chrono>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+
+    /**
+     * AnsweringReceiver plays the receiver's side of the UBX protocol on a pseudo terminal: it answers every command
+     * written to it with UBX-ACK-ACK, or UBX-ACK-NAK if Reject returns true for it, or not at all if Ignore does. The
+     * library's Read has to run to receive the answers. It runs on its own thread, so it does not use REQUIRE.
+     */
+    class AnsweringReceiver {
+    public:
+        explicit AnsweringReceiver(int master, std::function<bool(const neom8n::UBXFrame &)> reject = nullptr,
+                                   std::function<bool(const neom8n::UBXFrame &)> ignore = nullptr) :
+                master(master), reject(std::move(reject)), ignore(std::move(ignore)), thread([this]() { run(); }) {}
+
+        ~AnsweringReceiver() {
+            done = true;
+            thread.join();
+        }
+
+        // the commands received so far
+        std::vector<std::vector<uint8_t>> Commands() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return commands;
+        }
+
+    private:
+        void run() {
+            neom8n::SentenceFramer framer;
+            char buffer[256];
+            struct pollfd pfd = {master, POLLIN, 0};
+            while (!done) {
+                if (poll(&pfd, 1, 10) <= 0) {
+                    continue;
+                }
+                auto n = read(master, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    return;
+                }
+                framer.Push(buffer, n, [](std::string_view) {}, [&](const uint8_t *data, size_t length) {
+                    neom8n::UBXFrame frame;
+                    if (neom8n::DecodeUBX(data, length, frame) != neom8n::PARSE_OK) {
+                        return;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        commands.emplace_back(data, data + length);
+                    }
+                    if (ignore && ignore(frame)) {
+                        return;
+                    }
+                    auto ackID = reject && reject(frame) ? neom8n::UBX_ID_ACK_NAK : neom8n::UBX_ID_ACK_ACK;
+                    auto ack = neom8n::EncodeUBX(neom8n::UBX_CLASS_ACK, ackID, {frame.Class, frame.ID});
+                    if (write(master, ack.data(), ack.size()) < 0) {
+                        perror("write");
+                    }
+                });
+            }
+        }
+
+        int master;
+        std::function<bool(const neom8n::UBXFrame &)> reject;
+        std::function<bool(const neom8n::UBXFrame &)> ignore;
+        std::mutex mutex;
+        std::vector<std::vector<uint8_t>> commands;
+        std::atomic<bool> done{false};
+        std::thread thread;
+    };
+}
 
 TEST_CASE("get sentence type") {
     SECTION("GSV sentence type - valid") {
@@ -84,6 +160,13 @@ TEST_CASE("parse GGA sentence") {
         } catch (const neom8n::InvalidSentenceError &e) {
             FAIL("must be able to parse a valid sentence");
         }
+    }SECTION("below the geoid") {
+        auto gga = neom8n::GGA("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,-12.5,M,-31.4,M,,*65");
+        REQUIRE(gga.Altitude == "-12.5");
+        REQUIRE(gga.GeoIDSeparation == "-31.4");
+        auto fix = neom8n::GGAFix("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,-12.5,M,-31.4,M,,*65");
+        REQUIRE(fix.Altitude == Approx(-12.5));
+        REQUIRE(fix.GeoIDSeparation == Approx(-31.4));
     }SECTION("invalid sentence - no time") {
         try {
             auto gga = neom8n::GGA("$GNGGA,,2606.1722,S,02759.6365,E,1,05,3.0,1577.4,M,0.0,M,,*53");
@@ -153,3 +236,1314 @@ TEST_CASE("parse GSV sentence") {
 }
 
 
+
+
+TEST_CASE("tokenize sentence") {
+    SECTION("valid sentence") {
+        neom8n::SentenceFields f;
+        REQUIRE(neom8n::Tokenize("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n", f) == neom8n::PARSE_OK);
+        REQUIRE(f.Talker == "GP");
+        REQUIRE(f.Formatter == "GSV");
+        REQUIRE(f.Count == 15);
+        REQUIRE(f.Values[0] == "3");
+        REQUIRE(f.Values[10] == "");
+        REQUIRE(f.Values[14] == "10");
+        REQUIRE(f.Checksum == "48");
+    }SECTION("invalid sentence - no checksum") {
+        neom8n::SentenceFields f;
+        REQUIRE(neom8n::Tokenize("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10", f) ==
+                neom8n::PARSE_INVALID_SENTENCE);
+    }SECTION("invalid sentence - no start delimiter") {
+        neom8n::SentenceFields f;
+        REQUIRE(neom8n::Tokenize("GPGSV,3,3,11*48", f) == neom8n::PARSE_INVALID_SENTENCE);
+    }
+}
+
+TEST_CASE("parse GSV sentence - edge cases") {
+    SECTION("trailing signal ID") {
+        auto gsv = neom8n::GSV("$GPGSV,3,3,09,22,34,124,26,1*59");
+        REQUIRE(gsv.SatelliteInfos.size() == 1);
+        REQUIRE(gsv.SatelliteInfos[0].SatelliteID == "22");
+        REQUIRE(gsv.SatelliteInfos[0].SignalStrength == "26");
+    }SECTION("invalid sentence - no satellites") {
+        REQUIRE_THROWS_AS(neom8n::GSV("$GPGSV,1,1,00*79"), neom8n::InvalidSentenceError);
+    }SECTION("single satellite info") {
+        auto info = neom8n::SatelliteInfo(",09,23,131,");
+        REQUIRE(info.SatelliteID == "09");
+        REQUIRE(info.Elevation == "23");
+        REQUIRE(info.Azimuth == "131");
+        REQUIRE(info.SignalStrength == "");
+    }SECTION("position not known") {
+        auto info = neom8n::SatelliteInfo(",22,,,26");
+        REQUIRE(info.Elevation == "0");
+        REQUIRE(info.Azimuth == "0");
+        REQUIRE(info.SignalStrength == "26");
+        std::string s = "$GPGSV,3,3,11,22,,,26,28,87,220,,30,,,*4B";
+        auto view = neom8n::GSVView(s);
+        REQUIRE(view.SatelliteInfos[0].Elevation == "0");
+        REQUIRE(view.SatelliteInfos[2].Azimuth == "0");
+        auto gsv = neom8n::GSV(s);
+        REQUIRE(gsv.SatelliteInfos[0].Elevation == "0");
+        REQUIRE(gsv.SatelliteInfos[0].Azimuth == "0");
+        REQUIRE(gsv.SatelliteInfos[1].Elevation == "87");
+        REQUIRE(gsv.SatelliteInfos[2].Elevation == "0");
+        REQUIRE(gsv.SatelliteInfos[2].SignalStrength == "");
+    }
+}
+
+TEST_CASE("parse sentence views") {
+    SECTION("GGA view") {
+        std::string s = "$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54";
+        auto view = neom8n::GGAView(s);
+        REQUIRE(view.Talker == "GN");
+        REQUIRE(view.Latitude == "2606.1668");
+        REQUIRE(view.Latitude.data() == s.data() + 18);
+        auto gga = view.Materialize();
+        REQUIRE(gga.Type == neom8n::GGA_TYPE);
+        REQUIRE(gga.Latitude == "2606.1668");
+        REQUIRE(gga.GeoIDSeparation == "0.0");
+    }SECTION("GSV view") {
+        auto view = neom8n::GSVView("$GPGSV,3,2,10,09,23,131,30,12,30,276,,13,17,356,,17,26,037,05*75");
+        REQUIRE(view.SatelliteInfoCount == 4);
+        REQUIRE(view.SatelliteInfos[3].Azimuth == "037");
+        auto gsv = view.Materialize();
+        REQUIRE(gsv.SatelliteInfos.size() == 4);
+        REQUIRE(gsv.SatelliteInfos[1].SatelliteID == "12");
+        REQUIRE(gsv.SatelliteInfos[1].SignalStrength == "");
+    }SECTION("invalid sentence") {
+        REQUIRE_THROWS_AS(neom8n::GGAView("$GNGGA,,2606.1722,S,02759.6365,E,1,05,3.0,1577.4,M,0.0,M,,*53"),
+                          neom8n::InvalidSentenceError);
+    }
+}
+
+TEST_CASE("decode GGA sentence") {
+    SECTION("valid sentence") {
+        auto fix = neom8n::GGAFix("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54\r\n");
+        REQUIRE(fix.Type == neom8n::GGA_TYPE);
+        REQUIRE(fix.Talker[0] == 'G');
+        REQUIRE(fix.Talker[1] == 'N');
+        REQUIRE(fix.TimeOfDay == ((20 * 60 + 1) * 60 + 7) * 1000);
+        REQUIRE(fix.Latitude == Approx(-(26 + 6.1668 / 60)));
+        REQUIRE(fix.Longitude == Approx(27 + 59.6537 / 60));
+        REQUIRE(fix.QualityIndicator == 1);
+        REQUIRE(fix.NumberOfSatellitesUsed == 8);
+        REQUIRE(fix.HDOP == Approx(1.2));
+        REQUIRE(fix.Altitude == Approx(1584.9));
+        REQUIRE(fix.GeoIDSeparation == Approx(0.0));
+    }SECTION("western hemisphere, negative altitude and fractional seconds") {
+        auto fix = neom8n::GGAFix("$GPGGA,235959.25,4807.038,N,01131.000,W,1,12,0.9,-5.4,M,46.9,M,,*57");
+        REQUIRE(fix.TimeOfDay == 86399250);
+        REQUIRE(fix.Latitude == Approx(48.1173));
+        REQUIRE(fix.Longitude == Approx(-11.516666667));
+        REQUIRE(fix.Altitude == Approx(-5.4));
+    }SECTION("invalid sentence - no latitude") {
+        REQUIRE_THROWS_AS(neom8n::GGAFix("$GNGGA,074332.000,,S,02759.6365,E,1,05,3.0,1577.4,M,0.0,M,,*79"),
+                          neom8n::InvalidSentenceError);
+    }SECTION("invalid sentence - wrong type") {
+        REQUIRE_THROWS_AS(neom8n::GGAFix("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48"),
+                          neom8n::InvalidSentenceError);
+    }
+}
+
+TEST_CASE("parse without exceptions") {
+    SECTION("sentence type") {
+        neom8n::SentenceType t;
+        REQUIRE(neom8n::TryGetSentenceType("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48", t) ==
+                neom8n::PARSE_OK);
+        REQUIRE(t == neom8n::GSV_TYPE);
+        REQUIRE(neom8n::TryGetSentenceType(",074332.000,2606.1722,S*53", t) == neom8n::PARSE_INVALID_SENTENCE);
+        REQUIRE(neom8n::TryGetSentenceType("$GNABC,074332.000*53", t) == neom8n::PARSE_NO_MATCHING_TYPE);
+    }SECTION("GGA") {
+        neom8n::GGA gga;
+        REQUIRE(neom8n::TryParseGGA("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54",
+                                    gga) == neom8n::PARSE_OK);
+        REQUIRE(gga.Latitude == "2606.1668");
+        neom8n::GGAView view;
+        REQUIRE(neom8n::TryParseGGA("$GNGGA,074332.000,2606.1722,S,,E,1,05,3.0,1577.4,M,0.0,M,,*42", view) ==
+                neom8n::PARSE_INVALID_SENTENCE);
+        neom8n::GGAFix fix;
+        REQUIRE(neom8n::TryParseGGA("$GNGGA,074332.000,2606.1722,S,02759.6365,E,1,05,3.0,,M,0.0,M,,*4D", fix) ==
+                neom8n::PARSE_INVALID_SENTENCE);
+    }SECTION("GSV") {
+        neom8n::GSV gsv;
+        REQUIRE(neom8n::TryParseGSV("$GPGSV,3,2,10,09,23,131,30,12,30,276,,13,17,356,,17,26,037,05*75", gsv) ==
+                neom8n::PARSE_OK);
+        REQUIRE(gsv.SatelliteInfos.size() == 4);
+        REQUIRE(neom8n::TryParseGSV("$GPGSV,3,2,10,09,23*71", gsv) == neom8n::PARSE_INVALID_SENTENCE);
+    }
+}
+
+TEST_CASE("validate checksum") {
+    SECTION("checksum") {
+        REQUIRE(neom8n::Checksum("GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10") == 0x48);
+        REQUIRE(neom8n::Checksum("") == 0);
+        REQUIRE(neom8n::Checksum("GNGSA") == ('G' ^ 'N' ^ 'G' ^ 'S' ^ 'A'));
+    }SECTION("valid checksum") {
+        REQUIRE(neom8n::ValidChecksum("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n"));
+        REQUIRE(neom8n::ValidChecksum("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54"));
+        REQUIRE_FALSE(neom8n::ValidChecksum("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*49"));
+        REQUIRE_FALSE(neom8n::ValidChecksum("$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10"));
+    }SECTION("corrupted sentence") {
+        neom8n::GGAFix fix;
+        // a single flipped digit in the latitude
+        REQUIRE(neom8n::TryParseGGA("$GNGGA,200107.000,2606.1669,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54", fix) ==
+                neom8n::PARSE_CHECKSUM_MISMATCH);
+        neom8n::GSVView gsv;
+        REQUIRE(neom8n::TryParseGSV("$GPGSV,3,2,10,09,23,131,30,12,30,276,,13,17,356,,17,26,037,05*76", gsv) ==
+                neom8n::PARSE_CHECKSUM_MISMATCH);
+        REQUIRE_THROWS_AS(neom8n::GGA("$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*55"),
+                          neom8n::InvalidSentenceError);
+    }
+}
+
+TEST_CASE("parse other sentence types") {
+    SECTION("ZDA") {
+        auto zda = neom8n::ZDA("$GPZDA,082710.00,16,09,2002,00,00*64\r\n");
+        REQUIRE(zda.Type == neom8n::ZDA_TYPE);
+        REQUIRE(zda.Talker == "GP");
+        REQUIRE(zda.Time == "082710.00");
+        REQUIRE(zda.Day == "16");
+        REQUIRE(zda.Month == "09");
+        REQUIRE(zda.Year == "2002");
+        REQUIRE(zda.LocalZoneHours == "00");
+        REQUIRE(zda.LocalZoneMinutes == "00");
+    }SECTION("GSA") {
+        auto gsa = neom8n::GSA("$GNGSA,A,3,80,71,73,79,69,,,,,,,,1.83,1.09,1.47*17");
+        REQUIRE(gsa.Type == neom8n::GSA_TYPE);
+        REQUIRE(gsa.OperationMode == "A");
+        REQUIRE(gsa.NavigationMode == "3");
+        REQUIRE(gsa.SatelliteIDs == std::vector<std::string>{"80", "71", "73", "79", "69"});
+        REQUIRE(gsa.PDOP == "1.83");
+        REQUIRE(gsa.HDOP == "1.09");
+        REQUIRE(gsa.VDOP == "1.47");
+        REQUIRE(gsa.SystemID == "");
+        neom8n::GSAView view;
+        REQUIRE(neom8n::TryParseGSA("$GNGSA,A,3,80,71,,,,,,,,,,,1.83,1.09,1.47,1*0F", view) == neom8n::PARSE_OK);
+        REQUIRE(view.SatelliteIDCount == 2);
+        REQUIRE(view.SystemID == "1");
+    }SECTION("VTG") {
+        auto vtg = neom8n::VTG("$GPVTG,77.52,T,,M,0.004,N,0.008,K,A*06");
+        REQUIRE(vtg.Type == neom8n::VTG_TYPE);
+        REQUIRE(vtg.CourseOverGroundTrue == "77.52");
+        REQUIRE(vtg.CourseOverGroundMagnetic == "");
+        REQUIRE(vtg.SpeedOverGroundKnots == "0.004");
+        REQUIRE(vtg.SpeedOverGroundKmh == "0.008");
+        REQUIRE(vtg.ModeIndicator == "A");
+    }SECTION("GLL") {
+        auto gll = neom8n::GLL("$GPGLL,4717.11364,N,00833.91565,E,092321.00,A,A*60");
+        REQUIRE(gll.Type == neom8n::GLL_TYPE);
+        REQUIRE(gll.Latitude == "4717.11364");
+        REQUIRE(gll.NorthSouthIndicator == "N");
+        REQUIRE(gll.Longitude == "00833.91565");
+        REQUIRE(gll.EastWestIndicator == "E");
+        REQUIRE(gll.Time == "092321.00");
+        REQUIRE(gll.Status == "A");
+        REQUIRE(gll.ModeIndicator == "A");
+    }SECTION("TXT") {
+        auto txt = neom8n::TXT("$GPTXT,01,01,02,u-blox ag, www.u-blox.com*71");
+        REQUIRE(txt.Type == neom8n::TXT_TYPE);
+        REQUIRE(txt.NumberOfMessages == "01");
+        REQUIRE(txt.MessageNumber == "01");
+        REQUIRE(txt.TextIdentifier == "02");
+        REQUIRE(txt.Text == "u-blox ag, www.u-blox.com");
+    }SECTION("RMC") {
+        auto rmc = neom8n::RMC("$GPRMC,083559.00,A,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*57");
+        REQUIRE(rmc.Type == neom8n::RMC_TYPE);
+        REQUIRE(rmc.Time == "083559.00");
+        REQUIRE(rmc.Status == "A");
+        REQUIRE(rmc.Latitude == "4717.11437");
+        REQUIRE(rmc.NorthSouthIndicator == "N");
+        REQUIRE(rmc.Longitude == "00833.91522");
+        REQUIRE(rmc.EastWestIndicator == "E");
+        REQUIRE(rmc.SpeedOverGround == "0.004");
+        REQUIRE(rmc.CourseOverGround == "77.52");
+        REQUIRE(rmc.Date == "091202");
+        REQUIRE(rmc.MagneticVariation == "");
+        REQUIRE(rmc.ModeIndicator == "A");
+        REQUIRE(rmc.NavigationStatus == "");
+    }SECTION("RMC - no fix") {
+        neom8n::RMCView rmc;
+        REQUIRE(neom8n::TryParseRMC("$GPRMC,,V,,,,,,,,,,N*53", rmc) == neom8n::PARSE_OK);
+        REQUIRE(rmc.Status == "V");
+        REQUIRE(rmc.Latitude.empty());
+    }SECTION("RMC - invalid status") {
+        REQUIRE_THROWS_AS(
+                neom8n::RMC("$GPRMC,083559.00,X,4717.11437,N,00833.91522,E,0.004,77.52,091202,,,A*4E"),
+                neom8n::InvalidSentenceError);
+    }SECTION("wrong type") {
+        neom8n::VTGView vtg;
+        REQUIRE(neom8n::TryParseVTG("$GPGLL,4717.11364,N,00833.91565,E,092321.00,A,A*60", vtg) ==
+                neom8n::PARSE_INVALID_SENTENCE);
+    }
+}
+
+TEST_CASE("sentence type lookup") {
+    SECTION("all types") {
+        for (auto t : {neom8n::GGA_TYPE, neom8n::VTG_TYPE, neom8n::GSV_TYPE, neom8n::GLL_TYPE, neom8n::ZDA_TYPE,
+                       neom8n::TXT_TYPE, neom8n::RMC_TYPE, neom8n::GSA_TYPE}) {
+            REQUIRE(neom8n::StringToSentenceType(neom8n::SentenceTypeToString(t)) == t);
+        }
+    }SECTION("unsupported types") {
+        REQUIRE_THROWS_AS(neom8n::StringToSentenceType("GNS"), neom8n::NoMatchingSentenceTypeError);
+        REQUIRE_THROWS_AS(neom8n::StringToSentenceType("GG"), neom8n::NoMatchingSentenceTypeError);
+        REQUIRE_THROWS_AS(neom8n::StringToSentenceType(""), neom8n::NoMatchingSentenceTypeError);
+    }SECTION("formatter code") {
+        REQUIRE(neom8n::FormatterCode("GGA") == 0x474741);
+    }
+}
+
+TEST_CASE("read from device") {
+    PseudoTerminal pty;
+
+    SECTION("sentences are delivered and Stop interrupts Read") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        std::mutex m;
+        std::vector<std::string> received;
+        neoM8N.RegisterCallback("test", [&](std::string s) {
+            std::lock_guard<std::mutex> lock(m);
+            received.push_back(s);
+        });
+        std::vector<const char *> views;
+        neoM8N.RegisterCallback("view1", [&](std::string_view s) { views.push_back(s.data()); });
+        neoM8N.RegisterCallback("view2", [&](std::string_view s) { views.push_back(s.data()); });
+        std::thread reader([&]() { neoM8N.Read(); });
+
+        std::string data = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n"
+                           "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*49\r\n";
+        REQUIRE(write(pty.Master, data.data(), data.size()) == (ssize_t) data.size());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (neoM8N.RejectedSentences() == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+        REQUIRE(received.size() == 1);
+        REQUIRE(neom8n::GetSentenceType(received[0]) == neom8n::GSV_TYPE);
+        // both view callbacks see the same buffer
+        REQUIRE(views.size() == 2);
+        REQUIRE(views[0] == views[1]);
+        REQUIRE(neoM8N.RejectedSentences() == 1);
+    }SECTION("a sentence is delivered as soon as it arrives") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        std::atomic<bool> delivered{false};
+        neoM8N.RegisterCallback("test", [&](std::string_view) { delivered = true; });
+        std::thread reader([&]() { neoM8N.Read(); });
+        /* let Read block on the idle port first */
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        std::string data = "$GNZDA,165539.00,03,03,2021,00,00*74\r\n";
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(write(pty.Master, data.data(), data.size()) == (ssize_t) data.size());
+        auto deadline = start + std::chrono::seconds(2);
+        while (!delivered && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        auto latency = std::chrono::steady_clock::now() - start;
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(delivered);
+        REQUIRE(latency < std::chrono::milliseconds(200));
+    }SECTION("Stop interrupts an idle Read") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        std::thread reader([&]() { neoM8N.Read(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        auto start = std::chrono::steady_clock::now();
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200));
+    }SECTION("Stop before Read") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        neoM8N.Stop();
+        neoM8N.Read();
+        SUCCEED();
+    }
+}
+
+TEST_CASE("encode UBX messages") {
+    SECTION("frame") {
+        // UBX-CFG-RATE with a 200ms measurement period, from the u-blox M8 protocol specification
+        auto frame = neom8n::EncodeUBX(0x06, 0x08, {0xc8, 0x00, 0x01, 0x00, 0x01, 0x00});
+        REQUIRE(frame == std::vector<uint8_t>{0xb5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xc8, 0x00, 0x01, 0x00, 0x01, 0x00,
+                                              0xde, 0x6a});
+    }SECTION("CFG-PRT") {
+        auto frame = neom8n::EncodeCFGPRT(115200);
+        REQUIRE(frame.size() == 28);
+        REQUIRE(frame[2] == neom8n::UBX_CLASS_CFG);
+        REQUIRE(frame[3] == neom8n::UBX_ID_CFG_PRT);
+        REQUIRE(frame[4] == 20);
+        REQUIRE(frame[6] == neom8n::UBX_PORT_UART1);
+        // the baud rate, little-endian
+        REQUIRE(frame[14] == 0x00);
+        REQUIRE(frame[15] == 0xc2);
+        REQUIRE(frame[16] == 0x01);
+        REQUIRE(frame[17] == 0x00);
+    }
+}
+
+TEST_CASE("decode UBX messages") {
+    // a NAV-PVT payload with a 3D fix
+    std::vector<uint8_t> payload(neom8n::NAV_PVT_LENGTH, 0);
+    auto put = [&](size_t offset, uint32_t value, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            payload[offset + i] = (value >> (8 * i)) & 0xff;
+        }
+    };
+    put(0, 345600000, 4); // iTOW
+    put(4, 2021, 2);
+    put(6, 3, 1);
+    put(7, 3, 1);
+    put(8, 16, 1);
+    put(9, 55, 1);
+    put(10, 39, 1);
+    put(11, 0x07, 1); // valid date and time, fully resolved
+    put(16, static_cast<uint32_t>(-1234), 4); // nano
+    put(20, 3, 1); // 3D fix
+    put(21, 0x01, 1); // gnssFixOK
+    put(23, 11, 1);
+    put(24, 281234567, 4); // lon 28.1234567
+    put(28, static_cast<uint32_t>(-257654321), 4); // lat -25.7654321
+    put(32, 1390500, 4); // height 1390.5 m
+    put(36, 1364000, 4); // hMSL 1364 m
+    put(40, 2500, 4);
+    put(52, static_cast<uint32_t>(-150), 4); // velE
+    put(60, 150, 4);
+    put(76, 156, 2); // pDOP 1.56
+    auto frame = neom8n::EncodeUBX(neom8n::UBX_CLASS_NAV, neom8n::UBX_ID_NAV_PVT, payload);
+
+    SECTION("NAV-PVT") {
+        neom8n::NavPVTView pvt;
+        REQUIRE(neom8n::TryParseNavPVT(frame.data(), frame.size(), pvt) == neom8n::PARSE_OK);
+        REQUIRE(pvt.TimeOfWeek() == 345600000);
+        REQUIRE(pvt.Year() == 2021);
+        REQUIRE(pvt.Month() == 3);
+        REQUIRE(pvt.Day() == 3);
+        REQUIRE(pvt.Hour() == 16);
+        REQUIRE(pvt.Minute() == 55);
+        REQUIRE(pvt.Second() == 39);
+        REQUIRE(pvt.ValidDate());
+        REQUIRE(pvt.ValidTime());
+        REQUIRE(pvt.Nanoseconds() == -1234);
+        REQUIRE(pvt.FixType() == 3);
+        REQUIRE(pvt.FixOK());
+        REQUIRE_FALSE(pvt.DifferentialCorrections());
+        REQUIRE(pvt.NumberOfSatellites() == 11);
+        REQUIRE(pvt.LongitudeE7() == 281234567);
+        REQUIRE(pvt.Latitude() == Approx(-25.7654321));
+        REQUIRE(pvt.Height() == 1390500);
+        REQUIRE(pvt.HeightMSL() == 1364000);
+        REQUIRE(pvt.HorizontalAccuracy() == 2500);
+        REQUIRE(pvt.VelocityEast() == -150);
+        REQUIRE(pvt.GroundSpeed() == 150);
+        REQUIRE(pvt.PDOP() == 156);
+        // the view reads the frame in place
+        frame[neom8n::UBX_HEADER_LENGTH + 23] = 12;
+        REQUIRE(pvt.NumberOfSatellites() == 12);
+    }SECTION("frame") {
+        neom8n::UBXFrame f;
+        REQUIRE(neom8n::DecodeUBX(frame.data(), frame.size(), f) == neom8n::PARSE_OK);
+        REQUIRE(f.Class == neom8n::UBX_CLASS_NAV);
+        REQUIRE(f.ID == neom8n::UBX_ID_NAV_PVT);
+        REQUIRE(f.Payload == frame.data() + neom8n::UBX_HEADER_LENGTH);
+        REQUIRE(f.PayloadLength == neom8n::NAV_PVT_LENGTH);
+    }SECTION("invalid frames") {
+        neom8n::UBXFrame f;
+        neom8n::NavPVTView pvt;
+        REQUIRE(neom8n::DecodeUBX(frame.data(), frame.size() - 1, f) == neom8n::PARSE_INVALID_SENTENCE);
+        REQUIRE(neom8n::DecodeUBX(frame.data(), 4, f) == neom8n::PARSE_INVALID_SENTENCE);
+        frame[0] = '$';
+        REQUIRE(neom8n::DecodeUBX(frame.data(), frame.size(), f) == neom8n::PARSE_INVALID_SENTENCE);
+        frame[0] = neom8n::UBX_SYNC_1;
+        frame[40]++;
+        REQUIRE(neom8n::TryParseNavPVT(frame.data(), frame.size(), pvt) == neom8n::PARSE_CHECKSUM_MISMATCH);
+
+        auto prt = neom8n::EncodeCFGPRT(9600);
+        REQUIRE(neom8n::TryParseNavPVT(prt.data(), prt.size(), pvt) == neom8n::PARSE_NO_MATCHING_TYPE);
+        auto shortPVT = neom8n::EncodeUBX(neom8n::UBX_CLASS_NAV, neom8n::UBX_ID_NAV_PVT, {1, 2, 3});
+        REQUIRE(neom8n::TryParseNavPVT(shortPVT.data(), shortPVT.size(), pvt) == neom8n::PARSE_INVALID_SENTENCE);
+    }
+}
+
+TEST_CASE("configure baud rate") {
+    PseudoTerminal pty;
+
+    SECTION("unsupported baud rate") {
+        REQUIRE_THROWS_AS(neom8n::NeoM8N(pty.Device, 12345), neom8n::UnsupportedBaudRateError);
+    }SECTION("switch baud rate") {
+        neom8n::NeoM8N neoM8N(pty.Device, 38400);
+        REQUIRE(neoM8N.BaudRate() == 38400);
+        {
+            AnsweringReceiver receiver(pty.Master);
+            std::thread reader([&]() { neoM8N.Read(); });
+            REQUIRE(neoM8N.SetBaudRate(115200) == neom8n::ACK_OK);
+            neoM8N.Stop();
+            reader.join();
+            REQUIRE(receiver.Commands() == std::vector<std::vector<uint8_t>>{neom8n::EncodeCFGPRT(115200)});
+        }
+        REQUIRE(neoM8N.BaudRate() == 115200);
+        REQUIRE_THROWS_AS(neoM8N.SetBaudRate(1), neom8n::UnsupportedBaudRateError);
+    }SECTION("rejected baud rate") {
+        neom8n::NeoM8N neoM8N(pty.Device, 38400);
+        AnsweringReceiver receiver(pty.Master, [](const neom8n::UBXFrame &) { return true; });
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.SetBaudRate(115200) == neom8n::ACK_REJECTED);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(neoM8N.BaudRate() == 38400);
+    }SECTION("acknowledgement lost") {
+        neom8n::NeoM8N neoM8N(pty.Device, 38400);
+        // the receiver switches, but its answer to the switch is garbled; it answers the poll at the new rate
+        auto poll = neom8n::EncodeUBX(neom8n::UBX_CLASS_CFG, neom8n::UBX_ID_CFG_PRT, {neom8n::UBX_PORT_UART1});
+        AnsweringReceiver receiver(pty.Master, nullptr, [](const neom8n::UBXFrame &frame) {
+            return frame.PayloadLength > 1;
+        });
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.SetBaudRate(115200, std::chrono::milliseconds(100)) == neom8n::ACK_OK);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(receiver.Commands() == std::vector<std::vector<uint8_t>>{neom8n::EncodeCFGPRT(115200), poll});
+        REQUIRE(neoM8N.BaudRate() == 115200);
+    }SECTION("not switched") {
+        neom8n::NeoM8N neoM8N(pty.Device, 38400);
+        int slave = open(pty.Device.c_str(), O_RDWR | O_NOCTTY);
+        {
+            // the receiver ignores the switch and only answers what was written at its rate
+            AnsweringReceiver receiver(pty.Master, nullptr, [&](const neom8n::UBXFrame &frame) {
+                struct termios settings{};
+                return frame.PayloadLength > 1 || tcgetattr(slave, &settings) != 0 ||
+                       cfgetospeed(&settings) != B38400;
+            });
+            std::thread reader([&]() { neoM8N.Read(); });
+            REQUIRE(neoM8N.SetBaudRate(115200, std::chrono::milliseconds(100)) == neom8n::ACK_TIMEOUT);
+            neoM8N.Stop();
+            reader.join();
+            // the switch and a poll at either rate
+            REQUIRE(receiver.Commands().size() == 3);
+        }
+        REQUIRE(neoM8N.BaudRate() == 38400);
+        struct termios settings{};
+        REQUIRE(tcgetattr(slave, &settings) == 0);
+        REQUIRE(cfgetospeed(&settings) == B38400);
+        close(slave);
+    }SECTION("no hardware flow control") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        int slave = open(pty.Device.c_str(), O_RDWR | O_NOCTTY);
+        struct termios settings{};
+        REQUIRE(tcgetattr(slave, &settings) == 0);
+        REQUIRE((settings.c_cflag & CRTSCTS) == 0);
+        close(slave);
+    }SECTION("stalled output") {
+        neom8n::NeoM8N neoM8N(pty.Device);
+        int slave = open(pty.Device.c_str(), O_RDWR | O_NOCTTY);
+        // hold off the output, as a deasserted CTS would
+        REQUIRE(tcflow(slave, TCOOFF) == 0);
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(neoM8N.SetBaudRate(115200) == neom8n::ACK_WRITE_FAILED);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+        REQUIRE(neoM8N.BaudRate() == 9600);
+        tcflow(slave, TCOON);
+        close(slave);
+    }
+}
+
+TEST_CASE("prune sentence output") {
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+    // the rate the receiver was told to output each sentence type at, by message ID
+    auto rates = [](const std::vector<std::vector<uint8_t>> &commands) {
+        std::map<uint8_t, uint8_t> rates;
+        for (auto const &command : commands) {
+            neom8n::UBXFrame frame;
+            REQUIRE(neom8n::DecodeUBX(command.data(), command.size(), frame) == neom8n::PARSE_OK);
+            REQUIRE(frame.Class == neom8n::UBX_CLASS_CFG);
+            REQUIRE(frame.ID == neom8n::UBX_ID_CFG_MSG);
+            REQUIRE(frame.Payload[0] == neom8n::UBX_CLASS_NMEA);
+            rates[frame.Payload[1]] = frame.Payload[2];
+        }
+        return rates;
+    };
+    std::array<neom8n::AckStatus, neom8n::SENTENCE_TYPE_COUNT> allOK;
+    allOK.fill(neom8n::ACK_OK);
+
+    SECTION("message IDs") {
+        REQUIRE(neom8n::EncodeCFGMSG(neom8n::UBX_CLASS_NMEA, 0x03, 0) ==
+                std::vector<uint8_t>{0xb5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xf0, 0x03, 0x00, 0xfd, 0x15});
+        REQUIRE(neom8n::NMEAMessageID(neom8n::GGA_TYPE) == 0x00);
+        REQUIRE(neom8n::NMEAMessageID(neom8n::RMC_TYPE) == 0x04);
+        REQUIRE(neom8n::NMEAMessageID(neom8n::TXT_TYPE) == 0x41);
+    }SECTION("explicit types") {
+        AnsweringReceiver receiver(pty.Master);
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.SetSentenceOutput({neom8n::GGA_TYPE, neom8n::RMC_TYPE}) == allOK);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(rates(receiver.Commands()) == std::map<uint8_t, uint8_t>{{0x00, 1}, {0x01, 0}, {0x02, 0}, {0x03, 0},
+                                                                         {0x04, 1}, {0x05, 0}, {0x08, 0}, {0x41, 0}});
+    }SECTION("subscribed types") {
+        neoM8N.Subscribe<neom8n::GGAFix>("fix", [](const neom8n::GGAFix &) {});
+        neoM8N.Subscribe<neom8n::ZDAView>("time", [](const neom8n::ZDAView &) {});
+        neoM8N.Subscribe<neom8n::GSV>("sky", [](const neom8n::GSV &) {});
+        neoM8N.Unsubscribe("sky");
+        REQUIRE(neoM8N.SubscribedSentenceTypes() == std::vector<neom8n::SentenceType>{neom8n::GGA_TYPE,
+                                                                                      neom8n::ZDA_TYPE});
+        AnsweringReceiver receiver(pty.Master);
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.PruneSentenceOutput() == allOK);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(rates(receiver.Commands()) == std::map<uint8_t, uint8_t>{{0x00, 1}, {0x01, 0}, {0x02, 0}, {0x03, 0},
+                                                                         {0x04, 0}, {0x05, 0}, {0x08, 1}, {0x41, 0}});
+    }SECTION("each command has its own outcome") {
+        // the receiver refuses to disable GSV
+        AnsweringReceiver receiver(pty.Master, [](const neom8n::UBXFrame &frame) {
+            return frame.ID == neom8n::UBX_ID_CFG_MSG && frame.Payload[1] == 0x03;
+        });
+        std::thread reader([&]() { neoM8N.Read(); });
+        auto expected = allOK;
+        expected[neom8n::GSV_TYPE] = neom8n::ACK_REJECTED;
+        REQUIRE(neoM8N.SetSentenceOutput({neom8n::GGA_TYPE}) == expected);
+        // a command sent afterwards is not completed by an earlier command's answer
+        auto gsv = neoM8N.SendCommand(neom8n::EncodeCFGMSG(neom8n::UBX_CLASS_NMEA, 0x03, 0));
+        auto gll = neoM8N.SendCommand(neom8n::EncodeCFGMSG(neom8n::UBX_CLASS_NMEA, 0x01, 0));
+        REQUIRE(gsv.get() == neom8n::ACK_REJECTED);
+        REQUIRE(gll.get() == neom8n::ACK_OK);
+        neoM8N.Stop();
+        reader.join();
+        // GSV is still output, next to GGA
+        REQUIRE(neoM8N.LinkUtilisation() ==
+                Approx((neom8n::EstimatedSentenceBytes(neom8n::GGA_TYPE) +
+                        neom8n::EstimatedSentenceBytes(neom8n::GSV_TYPE)) / 960.0));
+    }
+}
+
+TEST_CASE("set navigation rate") {
+    PseudoTerminal pty;
+    // fast enough for the default output at 10 Hz
+    neom8n::NeoM8N neoM8N(pty.Device, 115200);
+
+    SECTION("encode") {
+        REQUIRE(neom8n::EncodeCFGRATE(100) ==
+                std::vector<uint8_t>{0xb5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7a,
+                                     0x12});
+    }SECTION("acknowledged") {
+        AnsweringReceiver receiver(pty.Master);
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.SetNavigationRate(100) == neom8n::ACK_OK);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(receiver.Commands() == std::vector<std::vector<uint8_t>>{neom8n::EncodeCFGRATE(100)});
+        REQUIRE(neoM8N.NavigationRate() == Approx(10));
+    }SECTION("rejected") {
+        AnsweringReceiver receiver(pty.Master, [](const neom8n::UBXFrame &) { return true; });
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(neoM8N.SetNavigationRate(100) == neom8n::ACK_REJECTED);
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(neoM8N.NavigationRate() == Approx(1));
+    }SECTION("not answered") {
+        REQUIRE(neoM8N.SetNavigationRate(100, 1, std::chrono::milliseconds(10)) == neom8n::ACK_TIMEOUT);
+        REQUIRE(neoM8N.NavigationRate() == Approx(1));
+    }SECTION("out of range") {
+        REQUIRE(neoM8N.SetNavigationRate(0) == neom8n::ACK_INVALID_ARGUMENT);
+        REQUIRE(neoM8N.SetNavigationRate(100, 0) == neom8n::ACK_INVALID_ARGUMENT);
+        REQUIRE(neoM8N.NavigationRate() == Approx(1));
+        // nothing was sent
+        int pending = -1;
+        REQUIRE(ioctl(pty.Master, FIONREAD, &pending) == 0);
+        REQUIRE(pending == 0);
+    }SECTION("link budget") {
+        // the default output fits 9600 baud at 1 Hz, but not at 5 Hz
+        neom8n::NeoM8N slow(pty.Device);
+        REQUIRE(slow.LinkUtilisation() < 1);
+        REQUIRE(slow.SetNavigationRate(200, 1, std::chrono::milliseconds(10)) == neom8n::ACK_LINK_OVERLOADED);
+        REQUIRE(slow.NavigationRate() == Approx(1));
+        REQUIRE(neoM8N.LinkUtilisation() < 0.1);
+        REQUIRE(neoM8N.SetNavigationRate(25, 1, std::chrono::milliseconds(10)) == neom8n::ACK_LINK_OVERLOADED);
+        // nor at 4800 baud, whether the baud rate is lowered or more sentences are enabled
+        REQUIRE(slow.SetBaudRate(4800, std::chrono::milliseconds(10)) == neom8n::ACK_LINK_OVERLOADED);
+        REQUIRE(slow.BaudRate() == 9600);
+        neom8n::NeoM8N slower(pty.Device, 4800);
+        std::array<neom8n::AckStatus, neom8n::SENTENCE_TYPE_COUNT> overloaded;
+        overloaded.fill(neom8n::ACK_LINK_OVERLOADED);
+        REQUIRE(slower.SetSentenceOutput({neom8n::GGA_TYPE, neom8n::VTG_TYPE, neom8n::GSV_TYPE, neom8n::GLL_TYPE,
+                                          neom8n::RMC_TYPE, neom8n::GSA_TYPE}, std::chrono::milliseconds(10)) ==
+                overloaded);
+        // nothing was sent
+        int pending = -1;
+        REQUIRE(ioctl(pty.Master, FIONREAD, &pending) == 0);
+        REQUIRE(pending == 0);
+    }
+}
+
+TEST_CASE("pipeline UBX commands") {
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+    std::thread reader([&]() { neoM8N.Read(); });
+
+    SECTION("answered in order") {
+        std::vector<std::vector<uint8_t>> commands = {
+                neom8n::EncodeCFGMSG(neom8n::UBX_CLASS_NMEA, neom8n::NMEAMessageID(neom8n::GSV_TYPE), 0),
+                neom8n::EncodeCFGMSG(neom8n::UBX_CLASS_NMEA, neom8n::NMEAMessageID(neom8n::GLL_TYPE), 0),
+                neom8n::EncodeCFGRATE(100),
+        };
+        std::vector<std::future<neom8n::AckStatus>> results;
+        for (auto const &command : commands) {
+            results.push_back(neoM8N.SendCommand(command));
+        }
+        std::atomic<neom8n::AckStatus> called{neom8n::ACK_WRITE_FAILED};
+        neoM8N.SendCommand(commands[0], [&](neom8n::AckStatus status) { called = status; });
+        // all commands have been written before the first answer
+        std::vector<uint8_t> written(11 + 11 + 14 + 11);
+        size_t received = 0;
+        while (received < written.size()) {
+            auto res = read(pty.Master, written.data() + received, written.size() - received);
+            REQUIRE(res > 0);
+            received += res;
+        }
+        REQUIRE(std::vector<uint8_t>(written.begin() + 22, written.begin() + 36) == commands[2]);
+        // the second CFG-MSG answer belongs to the second CFG-MSG command
+        std::string answers;
+        for (auto ack : {std::make_pair(neom8n::UBX_ID_ACK_ACK, neom8n::UBX_ID_CFG_RATE),
+                         std::make_pair(neom8n::UBX_ID_ACK_ACK, neom8n::UBX_ID_CFG_MSG),
+                         std::make_pair(neom8n::UBX_ID_ACK_NAK, neom8n::UBX_ID_CFG_MSG),
+                         std::make_pair(neom8n::UBX_ID_ACK_ACK, neom8n::UBX_ID_CFG_MSG)}) {
+            auto frame = neom8n::EncodeUBX(neom8n::UBX_CLASS_ACK, ack.first, {neom8n::UBX_CLASS_CFG, ack.second});
+            answers.append(frame.begin(), frame.end());
+        }
+        REQUIRE(write(pty.Master, answers.data(), answers.size()) == (ssize_t) answers.size());
+        for (auto &result : results) {
+            REQUIRE(result.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        }
+        REQUIRE(results[0].get() == neom8n::ACK_OK);
+        REQUIRE(results[1].get() == neom8n::ACK_REJECTED);
+        REQUIRE(results[2].get() == neom8n::ACK_OK);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (called == neom8n::ACK_WRITE_FAILED && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(called == neom8n::ACK_OK);
+    }SECTION("timed out by Read") {
+        auto result = neoM8N.SendCommand(neom8n::EncodeCFGRATE(100), std::chrono::milliseconds(20));
+        REQUIRE(result.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        REQUIRE(result.get() == neom8n::ACK_TIMEOUT);
+    }
+    neoM8N.Stop();
+    reader.join();
+}
+
+TEST_CASE("frame sentences") {
+    neom8n::SentenceFramer framer;
+    std::vector<std::string> sentences;
+    auto collect = [&](std::string_view s) { sentences.emplace_back(s); };
+    std::string gsv = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48";
+    std::string gga = "$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54";
+
+    SECTION("many sentences in one chunk") {
+        auto data = gsv + "\r\n" + gga + "\r\n";
+        framer.Push(data.data(), data.size(), collect);
+        REQUIRE(sentences == std::vector<std::string>{gsv, gga});
+    }SECTION("sentence split over chunks") {
+        auto data = "garbage\r\n" + gsv + "\r\n";
+        for (auto c : data) {
+            framer.Push(&c, 1, collect);
+        }
+        REQUIRE(sentences == std::vector<std::string>{gsv});
+    }SECTION("incomplete sentence is dropped at the next start delimiter") {
+        auto data = gga.substr(0, 20) + gsv + "\n";
+        framer.Push(data.data(), data.size(), collect);
+        REQUIRE(sentences == std::vector<std::string>{gsv});
+    }SECTION("overlong sentence is dropped") {
+        auto data = "$" + std::string(neom8n::MAX_SENTENCE_LENGTH, 'A') + "\r\n" + gsv + "\r\n";
+        framer.Push(data.data(), data.size(), collect);
+        REQUIRE(sentences == std::vector<std::string>{gsv});
+    }SECTION("sentences wrapping around the buffer") {
+        auto data = gsv + "\r\n";
+        size_t total = 0;
+        while (total < 3 * neom8n::SentenceFramer::BUFFER_SIZE) {
+            // read in odd-sized chunks straight into the buffer, like NeoM8N::Read does
+            for (size_t i = 0; i < data.size();) {
+                auto region = framer.WritableRegion();
+                auto n = std::min({region.second, data.size() - i, size_t(7)});
+                std::memcpy(region.first, data.data() + i, n);
+                framer.Commit(n, collect);
+                i += n;
+            }
+            total += data.size();
+        }
+        REQUIRE(sentences.size() == total / data.size());
+        for (auto &s : sentences) {
+            REQUIRE(s == gsv);
+        }
+    }SECTION("interleaved UBX frames") {
+        std::vector<std::vector<uint8_t>> frames;
+        auto collectUBX = [&](const uint8_t *f, size_t length) { frames.emplace_back(f, f + length); };
+        // the payload contains a start delimiter and a line ending, which must not be taken for a sentence
+        auto ubx = neom8n::EncodeUBX(neom8n::UBX_CLASS_NAV, neom8n::UBX_ID_NAV_PVT,
+                                     {'$', 'G', 'P', '\r', '\n', 0xb5, 0x62});
+        auto ack = neom8n::EncodeUBX(0x05, 0x01, {0x06, 0x00});
+        auto data = gsv + "\r\n" + std::string(ubx.begin(), ubx.end()) + gga + "\r\n" +
+                    std::string(ack.begin(), ack.end()) + "\xb5garbage" + gsv + "\r\n";
+        for (size_t i = 0; i < data.size(); i += 5) {
+            framer.Push(data.data() + i, std::min(size_t(5), data.size() - i), collect, collectUBX);
+        }
+        REQUIRE(sentences == std::vector<std::string>{gsv, gga, gsv});
+        REQUIRE(frames == std::vector<std::vector<uint8_t>>{ubx, ack});
+    }SECTION("UBX frames are skipped when only sentences are framed") {
+        auto ubx = neom8n::EncodeUBX(neom8n::UBX_CLASS_NAV, neom8n::UBX_ID_NAV_PVT, {'$', 'A', '\n'});
+        auto data = std::string(ubx.begin(), ubx.end()) + gsv + "\r\n";
+        framer.Push(data.data(), data.size(), collect);
+        REQUIRE(sentences == std::vector<std::string>{gsv});
+    }
+}
+
+TEST_CASE("parse incrementally") {
+    std::vector<std::string> sentences;
+    std::vector<neom8n::GGAFix> fixes;
+    neom8n::IncrementalParser parser([&](std::string_view s) { sentences.emplace_back(s); },
+                                     [&](const neom8n::GGAFix &fix) { fixes.push_back(fix); });
+    std::string gga = "$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54";
+    std::string gsv = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48";
+
+    SECTION("fix is ready with the last checksum digit") {
+        for (size_t i = 0; i + 1 < gga.size(); i++) {
+            parser.Feed(&gga[i], 1);
+            REQUIRE(fixes.empty());
+        }
+        parser.Feed(&gga.back(), 1);
+        REQUIRE(fixes.size() == 1);
+        REQUIRE(fixes[0].Talker[1] == 'N');
+        REQUIRE(fixes[0].Latitude == Approx(-(26 + 6.1668 / 60)));
+        REQUIRE(fixes[0].NumberOfSatellitesUsed == 8);
+        REQUIRE(sentences == std::vector<std::string>{gga});
+    }SECTION("stream of mixed sentences") {
+        auto data = "noise" + gsv + "\r\n" + gga + "\r\n" + gga.substr(0, 30) + gsv + "\r\n";
+        parser.Feed(data.data(), data.size());
+        REQUIRE(sentences == std::vector<std::string>{gsv, gga, gsv});
+        REQUIRE(fixes.size() == 1);
+    }SECTION("corrupted sentences are rejected") {
+        auto corrupted = gga;
+        corrupted[20] = '9';
+        parser.Feed(corrupted.data(), corrupted.size());
+        REQUIRE(sentences.empty());
+        REQUIRE(fixes.empty());
+        REQUIRE(parser.RejectedSentences() == 1);
+    }SECTION("invalid GGA is delivered only as a sentence") {
+        std::string invalid = "$GNGGA,074332.000,,S,02759.6365,E,1,05,3.0,1577.4,M,0.0,M,,*79";
+        parser.Feed(invalid.data(), invalid.size());
+        REQUIRE(sentences.size() == 1);
+        REQUIRE(fixes.empty());
+    }
+}
+
+TEST_CASE("typed subscriptions") {
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+
+    std::vector<const neom8n::GGA *> ggas;
+    std::vector<neom8n::GGAFix> fixes;
+    std::vector<size_t> satellites;
+    std::atomic<int> delivered{0};
+    neoM8N.Subscribe<neom8n::GGA>("a", [&](const neom8n::GGA &gga) { ggas.push_back(&gga); });
+    neoM8N.Subscribe<neom8n::GGA>("b", [&](const neom8n::GGA &gga) { ggas.push_back(&gga); });
+    neoM8N.Subscribe<neom8n::GGA>("c", [&](const neom8n::GGA &gga) { ggas.push_back(&gga); });
+    neoM8N.Subscribe<neom8n::GGAFix>("a", [&](const neom8n::GGAFix &fix) { fixes.push_back(fix); });
+    neoM8N.Subscribe<neom8n::GSVView>("a", [&](const neom8n::GSVView &gsv) {
+        satellites.push_back(gsv.SatelliteInfoCount);
+    });
+    neoM8N.Unsubscribe("c");
+    neoM8N.RegisterCallback("count", [&](std::string_view) { delivered++; });
+    std::thread reader([&]() { neoM8N.Read(); });
+
+    std::string data = "$GNGGA,200107.000,2606.1668,S,02759.6537,E,1,08,1.2,1584.9,M,0.0,M,,*54\r\n"
+                       "$GPGSV,3,2,10,09,23,131,30,12,30,276,,13,17,356,,17,26,037,05*75\r\n"
+                       "$GPZDA,082710.00,16,09,2002,00,00*64\r\n";
+    REQUIRE(write(pty.Master, data.data(), data.size()) == (ssize_t) data.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (delivered < 3 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    neoM8N.Stop();
+    reader.join();
+
+    // both GGA handlers were handed the same parsed object
+    REQUIRE(ggas.size() == 2);
+    REQUIRE(ggas[0] == ggas[1]);
+    REQUIRE(fixes.size() == 1);
+    REQUIRE(fixes[0].NumberOfSatellitesUsed == 8);
+    REQUIRE(satellites == std::vector<size_t>{4});
+}
+
+TEST_CASE("register callbacks while reading") {
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+    std::atomic<int> delivered{0};
+    neoM8N.RegisterCallback("count", [&](std::string_view) { delivered++; });
+    std::thread reader([&]() { neoM8N.Read(); });
+
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        std::string gsv = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n";
+        while (!done) {
+            if (write(pty.Master, gsv.data(), gsv.size()) < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+    std::atomic<int> transient{0};
+    for (int i = 0; i < 200; i++) {
+        auto key = "transient" + std::to_string(i % 4);
+        neoM8N.RegisterCallback(key, [&](std::string_view) { transient++; });
+        neoM8N.Subscribe<neom8n::GSVView>(key, [&](const neom8n::GSVView &) { transient++; });
+        std::this_thread::yield();
+        neoM8N.DeregisterCallback(key);
+        neoM8N.Unsubscribe(key);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (delivered < 100 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done = true;
+    writer.join();
+    neoM8N.Stop();
+    reader.join();
+    REQUIRE(delivered >= 100);
+}
+
+TEST_CASE("queue sentences between threads") {
+    SECTION("single-producer single-consumer queue") {
+        neom8n::SPSCQueue<int> q(3);
+        REQUIRE(q.Capacity() == 4);
+        int v;
+        REQUIRE_FALSE(q.TryPop(v));
+        for (int i = 0; i < 4; i++) {
+            REQUIRE(q.TryPush(i));
+        }
+        REQUIRE_FALSE(q.TryPush(4));
+        REQUIRE_FALSE(q.PushOverwrite(4));
+        REQUIRE(q.Size() == 4);
+        for (int i = 1; i <= 4; i++) {
+            REQUIRE(q.TryPop(v));
+            REQUIRE(v == i);
+        }
+        REQUIRE(q.Empty());
+        REQUIRE(q.PushOverwrite(5));
+    }
+
+    SECTION("values stay in order across threads") {
+        neom8n::SPSCQueue<int> q(16);
+        const int count = 100000;
+        std::thread producer([&]() {
+            for (int i = 0; i < count; i++) {
+                while (!q.TryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        int expected = 0, v;
+        bool ordered = true;
+        while (expected < count) {
+            if (q.TryPop(v)) {
+                ordered = ordered && v == expected;
+                expected++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        REQUIRE(ordered);
+    }
+
+    SECTION("dropping the oldest values keeps the rest in order") {
+        neom8n::SPSCQueue<int> q(8);
+        const int count = 100000;
+        std::atomic<bool> done{false};
+        std::thread producer([&]() {
+            for (int i = 0; i < count; i++) {
+                q.PushOverwrite(i);
+            }
+            /* PushOverwrite discards the newest value instead while the consumer copies out of its slot */
+            while (!q.TryPush(count)) {
+                std::this_thread::yield();
+            }
+            done = true;
+        });
+        int last = -1, v;
+        bool ordered = true, sized = true;
+        while (!done || !q.Empty()) {
+            sized = sized && q.Size() <= q.Capacity();
+            if (q.TryPop(v)) {
+                ordered = ordered && v > last;
+                last = v;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        REQUIRE(ordered);
+        REQUIRE(sized);
+        REQUIRE(last == count);
+    }
+
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+    const int count = 40;
+    std::string sentences;
+    for (int i = 0; i < count; i++) {
+        sentences += "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n";
+    }
+    auto waitFor = [](const std::function<bool()> &condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (!condition() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return condition();
+    };
+    std::atomic<int> delivered{0};
+
+    SECTION("a stalled consumer drops sentences instead of stalling Read") {
+        auto policy = GENERATE(neom8n::OVERFLOW_DROP_OLDEST, neom8n::OVERFLOW_DROP_NEWEST);
+        neoM8N.SetDispatchQueue(4, policy);
+        std::atomic<bool> started{false}, release{false};
+        neoM8N.RegisterCallback("slow", [&](std::string_view) {
+            started = true;
+            while (!release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            delivered++;
+        });
+        std::thread reader([&]() { neoM8N.Read(); });
+        auto length = sentences.size() / count;
+        REQUIRE(write(pty.Master, sentences.data(), length) == (ssize_t) length);
+        REQUIRE(waitFor([&]() { return started.load(); }));
+        REQUIRE(write(pty.Master, sentences.data() + length, sentences.size() - length) ==
+                (ssize_t) (sentences.size() - length));
+        /* one sentence is held by the callback and four are queued */
+        REQUIRE(waitFor([&]() { return neoM8N.DroppedSentences() == count - 5; }));
+        release = true;
+        REQUIRE(waitFor([&]() { return delivered == 5; }));
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(delivered == 5);
+    }
+
+    SECTION("blocking keeps every sentence") {
+        neoM8N.SetDispatchQueue(4, neom8n::OVERFLOW_BLOCK);
+        neoM8N.RegisterCallback("slow", [&](std::string_view) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            delivered++;
+        });
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(write(pty.Master, sentences.data(), sentences.size()) == (ssize_t) sentences.size());
+        REQUIRE(waitFor([&]() { return delivered == count; }));
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(neoM8N.DroppedSentences() == 0);
+    }
+
+    SECTION("Stop wakes up Read waiting for room") {
+        neoM8N.SetDispatchQueue(4, neom8n::OVERFLOW_BLOCK);
+        std::atomic<bool> release{false};
+        neoM8N.RegisterCallback("stalled", [&](std::string_view) {
+            while (!release) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(write(pty.Master, sentences.data(), sentences.size()) == (ssize_t) sentences.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto stopped = std::chrono::steady_clock::now();
+        neoM8N.Stop();
+        /* Read gives up the sentences it was waiting to queue while the consumer is still stalled */
+        REQUIRE(waitFor([&]() { return neoM8N.DroppedSentences() > 0; }));
+        auto elapsed = std::chrono::steady_clock::now() - stopped;
+        release = true;
+        reader.join();
+        /* rather than when its wait for room times out */
+        REQUIRE(elapsed < std::chrono::milliseconds(40));
+    }
+}
+
+TEST_CASE("read backends") {
+    auto type = GENERATE(neom8n::READ_BACKEND_EPOLL, neom8n::READ_BACKEND_IO_URING);
+    auto backend = neom8n::MakeReadBackend(type, 4);
+    if (!backend) {
+        WARN("read backend " << type << " not supported by this kernel");
+        return;
+    }
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    int token;
+    REQUIRE(backend->Add(fds[0], &token));
+    std::string received;
+    ssize_t last = -1;
+    auto onRead = [&](void *t, const char *data, ssize_t length) {
+        REQUIRE(t == &token);
+        if (length > 0) {
+            received.append(data, length);
+        }
+        last = length;
+    };
+    REQUIRE(write(fds[1], "$GPTXT", 6) == 6);
+    while (received.size() < 6) {
+        REQUIRE(backend->Wait(onRead));
+    }
+    REQUIRE(received == "$GPTXT");
+
+    /* Wake interrupts a Wait without data */
+    last = -1;
+    backend->Wake();
+    REQUIRE(backend->Wait(onRead));
+    REQUIRE(last == -1);
+
+    close(fds[1]);
+    while (last != 0) {
+        REQUIRE(backend->Wait(onRead));
+    }
+    REQUIRE(backend->SystemCalls() > 0);
+    close(fds[0]);
+}
+
+TEST_CASE("read mixed NMEA and UBX") {
+    PseudoTerminal pty;
+    neom8n::NeoM8N neoM8N(pty.Device);
+    auto capacity = GENERATE(0, 16);
+    neoM8N.SetDispatchQueue(capacity);
+    std::atomic<int> sentences{0};
+    std::vector<uint32_t> timesOfWeek;
+    std::vector<size_t> monitorLengths;
+    neoM8N.RegisterCallback("nmea", [&](std::string_view) { sentences++; });
+    neoM8N.RegisterUBXCallback("pvt", [&](const neom8n::UBXFrame &frame) {
+        if (frame.Class == 0x0a) {
+            monitorLengths.push_back(frame.PayloadLength);
+        }
+        neom8n::NavPVTView pvt;
+        if (neom8n::TryParseNavPVT(frame, pvt) == neom8n::PARSE_OK) {
+            timesOfWeek.push_back(pvt.TimeOfWeek());
+        }
+    });
+    std::thread reader([&]() { neoM8N.Read(); });
+
+    std::vector<uint8_t> payload(neom8n::NAV_PVT_LENGTH, 0);
+    payload[0] = 0x24; // '$'
+    payload[1] = 0x0a; // '\n'
+    auto pvt = neom8n::EncodeUBX(neom8n::UBX_CLASS_NAV, neom8n::UBX_ID_NAV_PVT, payload);
+    auto corrupted = pvt;
+    corrupted[10]++;
+    // a UBX-MON-VER frame, longer than any sentence
+    auto mon = neom8n::EncodeUBX(0x0a, 0x04, std::vector<uint8_t>(600, 0));
+    std::string gsv = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n";
+    auto data = gsv + std::string(pvt.begin(), pvt.end()) + std::string(corrupted.begin(), corrupted.end()) +
+                std::string(mon.begin(), mon.end()) + gsv;
+    REQUIRE(write(pty.Master, data.data(), data.size()) == (ssize_t) data.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (sentences < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    neoM8N.Stop();
+    reader.join();
+    REQUIRE(sentences == 2);
+    REQUIRE(timesOfWeek == std::vector<uint32_t>{0x0a24});
+    REQUIRE(monitorLengths == std::vector<size_t>{600});
+    REQUIRE(neoM8N.RejectedSentences() == 1);
+    REQUIRE(neoM8N.DroppedSentences() == 0);
+}
+
+TEST_CASE("read a group of receivers") {
+    auto backend = GENERATE(neom8n::READ_BACKEND_AUTO, neom8n::READ_BACKEND_EPOLL);
+    const int receiverCount = 3;
+    PseudoTerminal ptys[receiverCount];
+    std::mutex mutex;
+    std::map<int, std::vector<std::string>> received;
+    std::atomic<int> delivered{0};
+    neom8n::ReceiverGroup group([&](int id, std::string_view sentence) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received[id].emplace_back(sentence);
+        delivered++;
+    }, 2, true, backend);
+    REQUIRE(group.AddReceiver(ptys[0].Device) == 0);
+    REQUIRE(group.AddReceiver(ptys[1].Device, 115200) == 1);
+    int slave = open(ptys[2].Device.c_str(), O_RDWR | O_NOCTTY);
+    REQUIRE(slave >= 0);
+    REQUIRE(group.AddReceiver(slave) == 2);
+    REQUIRE(group.AddReceiver("/dev/does-not-exist") == -1);
+
+    std::thread reactor([&]() { group.Run(); });
+    std::vector<std::string> sentences = {
+            "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48",
+            "$GNZDA,165539.00,03,03,2021,00,00*74",
+            "$GNVTG,,T,,M,0.039,N,0.072,K,A*32",
+    };
+    for (int i = 0; i < receiverCount; i++) {
+        /* the sentences of one receiver are split over several writes */
+        auto data = sentences[i] + "\r\n" + sentences[i] + "\r\n$GNZDA,1655";
+        REQUIRE(write(ptys[i].Master, data.data(), data.size()) == (ssize_t) data.size());
+        std::string rest = "39.00,03,03,2021,00,00*74\r\n$GNZDA,junk*00\r\n";
+        REQUIRE(write(ptys[i].Master, rest.data(), rest.size()) == (ssize_t) rest.size());
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while ((delivered < 3 * receiverCount || group.RejectedSentences() < receiverCount) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    group.Stop();
+    reactor.join();
+
+    REQUIRE(received.size() == receiverCount);
+    for (int i = 0; i < receiverCount; i++) {
+        REQUIRE(received[i] == std::vector<std::string>{sentences[i], sentences[i], sentences[1]});
+    }
+    REQUIRE(group.RejectedSentences() == receiverCount);
+}
+
+TEST_CASE("size a group of receivers") {
+    const size_t receiverCount = neom8n::DEFAULT_MAX_DESCRIPTORS + 6;
+    std::vector<PseudoTerminal> ptys(receiverCount);
+    std::atomic<int> delivered{0};
+    auto count = [&](int id, std::string_view) {
+        if (id == receiverCount - 1) delivered++;
+    };
+
+    SECTION("sized for the receivers") {
+        auto backend = GENERATE(neom8n::READ_BACKEND_AUTO, neom8n::READ_BACKEND_EPOLL);
+        neom8n::ReceiverGroup group(count, 1, false, backend, receiverCount);
+        for (size_t i = 0; i < receiverCount; i++) {
+            REQUIRE(group.AddReceiver(ptys[i].Device) == (int) i);
+        }
+        std::thread reactor([&]() { group.Run(); });
+        std::string sentence = "$GNZDA,165539.00,03,03,2021,00,00*74\r\n";
+        REQUIRE(write(ptys.back().Master, sentence.data(), sentence.size()) == (ssize_t) sentence.size());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (delivered < 1 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        group.Stop();
+        reactor.join();
+        REQUIRE(delivered == 1);
+    }SECTION("beyond the size of an io_uring thread") {
+        std::unique_ptr<neom8n::ReceiverGroup> group;
+        try {
+            group = std::make_unique<neom8n::ReceiverGroup>(count, 1, false, neom8n::READ_BACKEND_IO_URING);
+        } catch (const neom8n::DeviceError &) {
+            /* no io_uring on this kernel */
+            return;
+        }
+        for (size_t i = 0; i < neom8n::DEFAULT_MAX_DESCRIPTORS; i++) {
+            REQUIRE(group->AddReceiver(ptys[i].Device) == (int) i);
+        }
+        REQUIRE(group->AddReceiver(ptys.back().Device) == -1);
+    }
+}
+
+TEST_CASE("read from byte sources") {
+    std::string data = "$GPGSV,3,3,11,22,34,124,26,28,87,220,,30,22,332,10*48\r\n"
+                       "$GNZDA,165539.00,03,03,2021,00,00*74\r\n"
+                       "$GNZDA,165539.00,03,03,2021,00,00*75\r\n";
+    std::vector<std::string> received;
+    auto collect = [&](neom8n::NeoM8N &neoM8N) {
+        neoM8N.RegisterCallback("collect", [&](std::string_view s) { received.emplace_back(s); });
+    };
+    auto serve = [&](int listener) {
+        return std::thread([listener, &data]() {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection >= 0) {
+                if (write(connection, data.data(), data.size()) < 0) {
+                    perror("write");
+                }
+                close(connection);
+            }
+        });
+    };
+
+    SECTION("Read returns at the end of a file") {
+        char path[] = "/tmp/neom8n_testXXXXXX";
+        int fd = mkstemp(path);
+        REQUIRE(fd >= 0);
+        REQUIRE(write(fd, data.data(), data.size()) == (ssize_t) data.size());
+        close(fd);
+        neom8n::NeoM8N neoM8N(std::make_unique<neom8n::FileSource>(path));
+        collect(neoM8N);
+        neoM8N.Read();
+        unlink(path);
+        REQUIRE(received.size() == 2);
+        REQUIRE(neoM8N.RejectedSentences() == 1);
+        // a recording cannot take commands
+        REQUIRE(neoM8N.SetBaudRate(115200) == neom8n::ACK_WRITE_FAILED);
+    }
+
+    SECTION("Read returns when the writer closes a pipe") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        neom8n::NeoM8N neoM8N(std::make_unique<neom8n::DescriptorSource>(fds[0]));
+        collect(neoM8N);
+        REQUIRE(write(fds[1], data.data(), data.size()) == (ssize_t) data.size());
+        close(fds[1]);
+        neoM8N.Read();
+        REQUIRE(received.size() == 2);
+    }
+
+    SECTION("a simulator writes to a pseudo terminal") {
+        auto source = std::make_unique<neom8n::PseudoTerminalSource>();
+        int simulator = open(source->SlaveName().c_str(), O_RDWR | O_NOCTTY);
+        REQUIRE(simulator >= 0);
+        neom8n::NeoM8N neoM8N(std::move(source));
+        collect(neoM8N);
+        std::thread reader([&]() { neoM8N.Read(); });
+        REQUIRE(write(simulator, data.data(), data.size()) == (ssize_t) data.size());
+        /* closing the simulator's end does not end the stream */
+        close(simulator);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (neoM8N.RejectedSentences() == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        neoM8N.Stop();
+        reader.join();
+        REQUIRE(received.size() == 2);
+    }
+
+    SECTION("a TCP connection") {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(listener >= 0);
+        struct sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(bind(listener, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0);
+        REQUIRE(listen(listener, 1) == 0);
+        socklen_t length = sizeof(address);
+        REQUIRE(getsockname(listener, reinterpret_cast<struct sockaddr *>(&address), &length) == 0);
+        auto server = serve(listener);
+        neom8n::NeoM8N neoM8N(std::make_unique<neom8n::SocketSource>("127.0.0.1", ntohs(address.sin_port)));
+        collect(neoM8N);
+        neoM8N.Read();
+        server.join();
+        close(listener);
+        REQUIRE(received.size() == 2);
+    }
+
+    SECTION("a Unix socket") {
+        std::string path = "/tmp/neom8n_test_" + std::to_string(getpid()) + ".sock";
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        REQUIRE(listener >= 0);
+        struct sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+        REQUIRE(bind(listener, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0);
+        REQUIRE(listen(listener, 1) == 0);
+        auto server = serve(listener);
+        neom8n::NeoM8N neoM8N(std::make_unique<neom8n::SocketSource>(path));
+        collect(neoM8N);
+        neoM8N.Read();
+        server.join();
+        close(listener);
+        unlink(path.c_str());
+        REQUIRE(received.size() == 2);
+    }
+
+    SECTION("sources that cannot be opened throw") {
+        REQUIRE_THROWS_AS(neom8n::NeoM8N("/dev/does-not-exist"), neom8n::DeviceError);
+        REQUIRE_THROWS_AS(neom8n::FileSource("/does/not/exist"), neom8n::DeviceError);
+        REQUIRE_THROWS_AS(neom8n::SocketSource("/does/not/exist"), neom8n::DeviceError);
+    }
+}
@@ -0,0 +1,56 @@
+// PseudoTerminal stands in for a receiver's serial port in the tests and the benchmark: the library opens Device, the
+// test plays the receiver on Master.
+
+#ifndef NEOM8N_PSEUDO_TERMINAL_H
+#define NEOM8N_PSEUDO_TERMINAL_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+struct PseudoTerminal {
+    PseudoTerminal() : Master(posix_openpt(O_RDWR | O_NOCTTY)) {
+        if (Master < 0 || grantpt(Master) != 0 || unlockpt(Master) != 0) {
+            auto error = errno;
+            if (Master >= 0) {
+                close(Master);
+            }
+            throw std::system_error(error, std::generic_category(), "posix_openpt");
+        }
+        Device = ptsname(Master);
+    }
+
+    ~PseudoTerminal() {
+        close(Master);
+    }
+
+    PseudoTerminal(const PseudoTerminal &) = delete;
+
+    PseudoTerminal &operator=(const PseudoTerminal &) = delete;
+
+    /**
+     * OpenDevice opens Device in raw mode, for reading it without the library.
+     * @param flags added to O_RDWR | O_NOCTTY
+     * @return the descriptor, which the caller closes
+     */
+    int OpenDevice(int flags = 0) const {
+        int fd = open(Device.c_str(), O_RDWR | O_NOCTTY | flags);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), Device);
+        }
+        struct termios raw{};
+        tcgetattr(fd, &raw);
+        cfmakeraw(&raw);
+        tcsetattr(fd, TCSANOW, &raw);
+        return fd;
+    }
+
+    int Master;
+    std::string Device;
+};
+
+#endif //NEOM8N_PSEUDO_TERMINAL_H